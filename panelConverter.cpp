@@ -0,0 +1,65 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample. DEploid-vcf-lib is a submodule for
+ * reading the vcf files and reference panel.
+ *
+ * Copyright (C) 2018 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of DEploid-vcf-lib.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <iostream>  // std::cout
+#include "binaryPanel.hpp"
+#include "txtReader.hpp"
+
+/*! Convert a text or gzipped text panel to the binary panel format.
+ *
+ *  panel_converter <in.txt[.gz]> <out.bin> [-auto|-double|-float|-bit]
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0]
+                  << " <in.txt[.gz]> <out.bin> [-auto|-double|-float|-bit]"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+    try {
+        BinaryPanelType type = BINARY_PANEL_AUTO;
+        if (argc > 3) {
+            string flag(argv[3]);
+            if (flag == "-double") {
+                type = BINARY_PANEL_FLOAT64;
+            } else if (flag == "-float") {
+                type = BINARY_PANEL_FLOAT32;
+            } else if (flag == "-bit") {
+                type = BINARY_PANEL_BIT;
+            } else if (flag != "-auto") {
+                throw UnknowArg(flag);
+            }
+        }
+        TxtReader panel;
+        panel.readFromFile(argv[1]);
+        BinaryPanel::write(panel, argv[2], type);
+        return EXIT_SUCCESS;
+    }
+    catch (const exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,435 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close
+#include <zlib.h>       // crc32
+#include <algorithm>    // std::fill, std::reverse
+#include <cstddef>      // offsetof
+#include <cstring>      // memcpy, memcmp
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "binaryPanel.hpp"
+#include "exceptions.hpp"
+#include "txtReader.hpp"
+#include "global.hpp"
+
+using std::vector;
+using std::endl;
+
+const char BinaryPanel::magic_[8] = {'D', 'E', 'P', 'L', 'O', 'I', 'D', 'B'};
+
+
+namespace {
+
+bool isLittleEndian() {
+    const uint16_t one = 1;
+    unsigned char firstByte;
+    memcpy(&firstByte, &one, 1);
+    return firstByte == 1;
+}
+
+
+/*! Converts between the byte order of the host and the little-endian order
+ *  of the file, the same call works both ways */
+template <class T>
+T littleEndian(T value) {
+    if (!isLittleEndian()) {
+        unsigned char bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        std::reverse(bytes, bytes + sizeof(T));
+        memcpy(&value, bytes, sizeof(T));
+    }
+    return value;
+}
+
+
+template <class T>
+T loadLittleEndian(const char * data) {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return littleEndian(value);
+}
+
+
+size_t paddedTo8(size_t nBytes) {
+    return (nBytes + 7) / 8 * 8;
+}
+
+
+size_t matrixRowBytes(uint32_t type, size_t nStrains) {
+    switch (type) {
+        case BINARY_PANEL_FLOAT64: return nStrains * sizeof(double);
+        case BINARY_PANEL_FLOAT32: return nStrains * sizeof(float);
+        case BINARY_PANEL_BIT: return (nStrains + 7) / 8;
+    }
+    return 0;
+}
+
+
+size_t payloadBytes(uint32_t type, size_t nLoci, size_t nStrains,
+                    size_t nChrom) {
+    return (nChrom + 1) * sizeof(uint64_t) +
+           paddedTo8(nLoci * sizeof(int32_t)) +
+           nLoci * matrixRowBytes(type, nStrains);
+}
+
+
+/*! Writes to the output file and keeps a running crc32 of what was written */
+class CrcWriter {
+ public:
+    explicit CrcWriter(std::ofstream * out) : out_(out) {
+        this->crc_ = crc32(0L, Z_NULL, 0); }
+    void write(const void * data, size_t nBytes) {
+        this->out_->write(reinterpret_cast<const char *>(data), nBytes);
+        this->crc_ = crc32(this->crc_,
+                           reinterpret_cast<const Bytef *>(data), nBytes);
+    }
+    void pad(size_t nBytes) {
+        const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        this->write(zeros, paddedTo8(nBytes) - nBytes);
+    }
+    template <class T>
+    void writeLittleEndian(T value) {
+        value = littleEndian(value);
+        this->write(&value, sizeof(value));
+    }
+    uint32_t crc() const { return static_cast<uint32_t>(this->crc_); }
+
+ private:
+    std::ofstream * out_;
+    uLong crc_;
+};
+
+
+void appendString(string * table, const string & str) {
+    uint32_t length = littleEndian(static_cast<uint32_t>(str.size()));
+    table->append(reinterpret_cast<const char *>(&length), sizeof(length));
+    table->append(str);
+}
+
+
+struct FixedHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t type;
+    uint64_t nLoci;
+    uint64_t nStrains;
+    uint64_t nChrom;
+    uint64_t stringBytes;
+    uint64_t payloadBytes;
+    uint32_t headerCrc;
+    uint32_t payloadCrc;
+};
+
+
+void headerLittleEndian(FixedHeader * header) {
+    header->version = littleEndian(header->version);
+    header->type = littleEndian(header->type);
+    header->nLoci = littleEndian(header->nLoci);
+    header->nStrains = littleEndian(header->nStrains);
+    header->nChrom = littleEndian(header->nChrom);
+    header->stringBytes = littleEndian(header->stringBytes);
+    header->payloadBytes = littleEndian(header->payloadBytes);
+    header->headerCrc = littleEndian(header->headerCrc);
+    header->payloadCrc = littleEndian(header->payloadCrc);
+}
+
+}  // namespace
+
+
+void BinaryPanel::write(const TxtReader & panel, const string & fileName,
+                        BinaryPanelType type) {
+    // The strain names of the string table are the columns of the matrix
+    size_t nLoci = panel.content_.size();
+    size_t nStrains = panel.header_.size();
+    for (auto const &row : panel.content_) {
+        if (row.size() != nStrains) {
+            throw InvalidBinaryPanel(fileName,
+                                     "rows do not have one value per strain");
+        }
+    }
+
+    if (type == BINARY_PANEL_AUTO) {
+        type = BINARY_PANEL_BIT;
+        for (auto const &row : panel.content_) {
+            for (auto const &value : row) {
+                if (value != 0.0 && value != 1.0) {
+                    type = BINARY_PANEL_FLOAT64;
+                    break;
+                }
+            }
+            if (type != BINARY_PANEL_BIT) {
+                break;
+            }
+        }
+    }
+
+    string stringTable;
+    for (auto const &chrom : panel.chrom_) {
+        appendString(&stringTable, chrom);
+    }
+    for (auto const &strain : panel.header_) {
+        appendString(&stringTable, strain);
+    }
+    stringTable.resize(paddedTo8(stringTable.size()), '\0');
+
+    FixedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BinaryPanel::magic_, sizeof(header.magic));
+    header.version = BinaryPanel::version_;
+    header.type = type;
+    header.nLoci = nLoci;
+    header.nStrains = nStrains;
+    header.nChrom = panel.chrom_.size();
+    header.stringBytes = stringTable.size();
+    header.payloadBytes = payloadBytes(type, nLoci, nStrains,
+                                       panel.chrom_.size());
+
+    std::ofstream out(fileName.c_str(),
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+        throw InvalidInputFile(fileName);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(stringTable.data(), stringTable.size());
+
+    // The positions are already in CSR form
+    CrcWriter payload(&out);
+    for (auto const &value : panel.position_.offsets()) {
+        payload.writeLittleEndian(static_cast<uint64_t>(value));
+    }
+    for (auto const &value : panel.position_.values()) {
+        payload.writeLittleEndian(static_cast<int32_t>(value));
+    }
+    payload.pad(nLoci * sizeof(int32_t));
+
+    vector <unsigned char> bits(matrixRowBytes(BINARY_PANEL_BIT, nStrains));
+    // Scratch rows of the types that need converting
+    vector <float> floats;
+    vector <double> doubles;
+    if (type == BINARY_PANEL_FLOAT32) {
+        floats.resize(nStrains);
+    } else if (type == BINARY_PANEL_FLOAT64 && !isLittleEndian()) {
+        doubles.resize(nStrains);
+    }
+    for (auto const &row : panel.content_) {
+        if (type == BINARY_PANEL_FLOAT64 && isLittleEndian()) {
+            payload.write(row.data(), nStrains * sizeof(double));
+        } else if (type == BINARY_PANEL_FLOAT64) {
+            for (size_t i = 0; i < nStrains; i++) {
+                doubles[i] = littleEndian(row[i]);
+            }
+            payload.write(doubles.data(), nStrains * sizeof(double));
+        } else if (type == BINARY_PANEL_FLOAT32) {
+            for (size_t i = 0; i < nStrains; i++) {
+                floats[i] = littleEndian(static_cast<float>(row[i]));
+            }
+            payload.write(floats.data(), nStrains * sizeof(float));
+        } else {
+            std::fill(bits.begin(), bits.end(), 0);
+            for (size_t i = 0; i < nStrains; i++) {
+                if (row[i] != 0.0) {
+                    bits[i / 8] |= static_cast<unsigned char>(1 << (i % 8));
+                }
+            }
+            payload.write(bits.data(), bits.size());
+        }
+    }
+
+    // The header checksum covers the bytes as they are in the file
+    header.payloadCrc = payload.crc();
+    headerLittleEndian(&header);
+    uLong headerCrc = crc32(0L, Z_NULL, 0);
+    headerCrc = crc32(headerCrc, reinterpret_cast<const Bytef *>(&header),
+                      offsetof(FixedHeader, headerCrc));
+    headerCrc = crc32(headerCrc,
+                      reinterpret_cast<const Bytef *>(stringTable.data()),
+                      stringTable.size());
+    header.headerCrc = littleEndian(static_cast<uint32_t>(headerCrc));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (out.fail()) {
+        throw InvalidInputFile(fileName);
+    }
+    dout << "Binary panel written to " << fileName << endl;
+}
+
+
+void BinaryPanel::read(const string & fileName, TxtReader * panel) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw InvalidInputFile(fileName);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 ||
+            static_cast<size_t>(fileStat.st_size) < sizeof(FixedHeader)) {
+        close(fd);
+        throw InvalidBinaryPanel(fileName, "file is truncated");
+    }
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void * mapped = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw InvalidInputFile(fileName);
+    }
+    const char * data = reinterpret_cast<const char *>(mapped);
+
+    try {
+        BinaryPanel::read(data, fileSize, fileName, panel);
+    } catch (...) {
+        munmap(mapped, fileSize);
+        throw;
+    }
+    munmap(mapped, fileSize);
+}
+
+
+void BinaryPanel::read(const char * data, size_t size, const string & fileName,
+                       TxtReader * panel) {
+    if (size < sizeof(FixedHeader)) {
+        throw InvalidBinaryPanel(fileName, "file is truncated");
+    }
+    FixedHeader header;
+    memcpy(&header, data, sizeof(header));
+    headerLittleEndian(&header);
+    if (memcmp(header.magic, BinaryPanel::magic_, 8) != 0 ||
+            header.version != BinaryPanel::version_ ||
+            matrixRowBytes(header.type, 1) == 0) {
+        throw InvalidBinaryPanel(fileName, "unknown format");
+    }
+    if (header.payloadBytes != payloadBytes(header.type, header.nLoci,
+                                            header.nStrains,
+                                            header.nChrom) ||
+            sizeof(header) + header.stringBytes + header.payloadBytes
+                != size) {
+        throw InvalidBinaryPanel(fileName, "file is truncated");
+    }
+
+    const char * stringTable = data + sizeof(header);
+    const char * payload = stringTable + header.stringBytes;
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(data),
+                offsetof(FixedHeader, headerCrc));
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(stringTable),
+                header.stringBytes);
+    if (static_cast<uint32_t>(crc) != header.headerCrc) {
+        throw InvalidBinaryPanel(fileName, "header checksum mismatch");
+    }
+    crc = crc32(crc32(0L, Z_NULL, 0),
+                reinterpret_cast<const Bytef *>(payload),
+                header.payloadBytes);
+    if (static_cast<uint32_t>(crc) != header.payloadCrc) {
+        throw InvalidBinaryPanel(fileName, "payload checksum mismatch");
+    }
+
+    // Strings
+    vector <string> names;
+    size_t cursor = 0;
+    for (size_t i = 0; i < header.nChrom + header.nStrains; i++) {
+        if (cursor + sizeof(uint32_t) > header.stringBytes) {
+            throw InvalidBinaryPanel(fileName, "bad string table");
+        }
+        uint32_t length = loadLittleEndian<uint32_t>(stringTable + cursor);
+        cursor += sizeof(length);
+        if (cursor + length > header.stringBytes) {
+            throw InvalidBinaryPanel(fileName, "bad string table");
+        }
+        names.push_back(string(stringTable + cursor, length));
+        cursor += length;
+    }
+    panel->header_.assign(names.begin() + header.nChrom, names.end());
+
+    // Positions, rows that are not on the allow-list of the panel are
+    // left out, as are chromosomes without any remaining rows
+    vector <uint64_t> offsets(header.nChrom + 1);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        offsets[i] = loadLittleEndian<uint64_t>(payload +
+                                                i * sizeof(uint64_t));
+    }
+    const char * positions = payload + offsets.size() * sizeof(uint64_t);
+    if (offsets.front() != 0 || offsets.back() != header.nLoci) {
+        throw InvalidBinaryPanel(fileName, "bad chromosome offsets");
+    }
+    // The header has the exact number of rows
+    vector <size_t> keptRows;
+    keptRows.reserve(header.nLoci);
+    panel->clearChrom();
+    panel->position_.clear();
+    panel->position_.reserve(header.nChrom, header.nLoci);
+    for (size_t chromI = 0; chromI < header.nChrom; chromI++) {
+        if (offsets[chromI + 1] < offsets[chromI]) {
+            throw InvalidBinaryPanel(fileName, "bad chromosome offsets");
+        }
+        ChromId chromId = ChromDictionary::global().intern(names[chromI]);
+        vector <int> chromPositions;
+        for (size_t row = offsets[chromI]; row < offsets[chromI + 1];
+             row++) {
+            int32_t pos = loadLittleEndian<int32_t>(positions +
+                                                    row * sizeof(int32_t));
+            if (panel->isAllowed(chromId, pos)) {
+                chromPositions.push_back(pos);
+                keptRows.push_back(row);
+            }
+        }
+        if (chromPositions.size() > 0) {
+            panel->addChrom(chromId);
+            panel->position_.push_back(chromPositions);
+        }
+    }
+
+    // Matrix
+    const char * matrix = positions +
+                          paddedTo8(header.nLoci * sizeof(int32_t));
+    size_t rowBytes = matrixRowBytes(header.type, header.nStrains);
+    panel->content_.assign(keptRows.size(),
+                           vector <double>(header.nStrains));
+    for (size_t i = 0; i < keptRows.size(); i++) {
+        const char * rowData = matrix + keptRows[i] * rowBytes;
+        vector <double> & contentRow = panel->content_[i];
+        if (header.type == BINARY_PANEL_FLOAT64 && isLittleEndian()) {
+            memcpy(contentRow.data(), rowData, rowBytes);
+        } else if (header.type == BINARY_PANEL_FLOAT64) {
+            for (size_t j = 0; j < header.nStrains; j++) {
+                contentRow[j] = loadLittleEndian<double>(
+                    rowData + j * sizeof(double));
+            }
+        } else if (header.type == BINARY_PANEL_FLOAT32) {
+            for (size_t j = 0; j < header.nStrains; j++) {
+                contentRow[j] = static_cast<double>(loadLittleEndian<float>(
+                    rowData + j * sizeof(float)));
+            }
+        } else {
+            for (size_t j = 0; j < header.nStrains; j++) {
+                contentRow[j] = (rowData[j / 8] >> (j % 8)) & 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_BINARYPANEL_HPP_
+#define DEPLOID_SRC_BINARYPANEL_HPP_
+
+#include <stdint.h>
+#include <string>
+
+using std::string;
+
+class TxtReader;
+
+/*! \brief Binary panel format
+ *
+ *  A binary panel holds the same data as a text panel (CHROM, POS and one
+ *  column per strain) in a form that can be mapped into memory without any
+ *  text parsing. All integers are little-endian.
+ *
+ *  Fixed header, 64 bytes:
+ *
+ *      offset  size  field
+ *       0       8    magic "DEPLOIDB"
+ *       8       4    format version, currently 1
+ *      12       4    element type, see BinaryPanelType
+ *      16       8    number of loci (rows)
+ *      24       8    number of strains (columns)
+ *      32       8    number of chromosomes
+ *      40       8    size of the string table in bytes
+ *      48       8    size of the payload in bytes
+ *      56       4    crc32 of bytes [0, 56) and the string table
+ *      60       4    crc32 of the payload
+ *
+ *  String table: the chromosome names followed by the strain names, each
+ *  stored as a uint32 length and the characters, padded with zeros to a
+ *  multiple of 8 bytes.
+ *
+ *  Payload, in CSR form:
+ *
+ *      uint64 chromosome offsets, number of chromosomes + 1 entries, the
+ *             rows of chromosome i are [offset[i], offset[i+1])
+ *      int32  positions, one per row, padded with zeros to 8 bytes
+ *      matrix rows in file order, each row holds one entry per strain:
+ *             float64 or float32 values, or one bit per strain (least
+ *             significant bit first) with every row padded to whole bytes
+ *
+ *  The file size and both checksums are verified when a panel is loaded, so
+ *  truncated or corrupted files are rejected.
+ */
+enum BinaryPanelType {
+    BINARY_PANEL_AUTO = 0,  // bit-packed when all entries are 0 or 1
+    BINARY_PANEL_FLOAT64 = 1,
+    BINARY_PANEL_FLOAT32 = 2,
+    BINARY_PANEL_BIT = 3
+};
+
+
+class BinaryPanel {
+ public:
+    static const char magic_[8];
+    static const uint32_t version_ = 1;
+
+    /*! Write a loaded text panel as a binary panel */
+    static void write(const TxtReader & panel, const string & fileName,
+                      BinaryPanelType type = BINARY_PANEL_AUTO);
+    /*! Map a binary panel into memory and fill the panel, keeping only the
+     *  rows on the allow-list of the panel when it has one */
+    static void read(const string & fileName, TxtReader * panel);
+    /*! Fill the panel from a binary panel in memory, e.g. one that was read
+     *  from a pipe, fileName is what errors show */
+    static void read(const char * data, size_t size, const string & fileName,
+                     TxtReader * panel);
+};
+
+#endif  // DEPLOID_SRC_BINARYPANEL_HPP_
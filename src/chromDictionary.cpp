@@ -0,0 +1,105 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cassert>
+#include "chromDictionary.hpp"
+
+
+ChromDictionary & ChromDictionary::global() {
+    static ChromDictionary dictionary;
+    return dictionary;
+}
+
+
+ChromId ChromDictionary::intern(const string & name) {
+    // Rows come in runs of the same chromosome, so the last id of this
+    // thread is nearly always the answer and the lock is not needed
+    static thread_local string lastName;
+    static thread_local ChromId lastId = 0;
+    static thread_local bool hasLast = false;
+    if (hasLast && name == lastName) {
+        return lastId;
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::unordered_map<string, ChromId>::const_iterator it =
+        this->ids_.find(name);
+    ChromId id;
+    if (it != this->ids_.end()) {
+        id = it->second;
+    } else {
+        id = static_cast<ChromId>(this->names_.size());
+        this->names_.push_back(name);
+        this->ids_.insert(std::make_pair(name, id));
+    }
+    lastName = name;
+    lastId = id;
+    hasLast = true;
+    return id;
+}
+
+
+bool ChromDictionary::internContigLine(const string & line) {
+    const string prefix("##contig=<");
+    if (line.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    size_t idStart = line.find("ID=", prefix.size());
+    if (idStart == string::npos) {
+        return false;
+    }
+    idStart += 3;
+    size_t idEnd = line.find_first_of(",>", idStart);
+    if (idEnd == string::npos || idEnd == idStart) {
+        return false;
+    }
+    this->intern(line.substr(idStart, idEnd - idStart));
+    return true;
+}
+
+
+bool ChromDictionary::find(const string & name, ChromId * id) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    std::unordered_map<string, ChromId>::const_iterator it =
+        this->ids_.find(name);
+    if (it == this->ids_.end()) {
+        return false;
+    }
+    *id = it->second;
+    return true;
+}
+
+
+const string & ChromDictionary::name(const ChromId id) const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    assert(id < this->names_.size());
+    return this->names_[id];
+}
+
+
+size_t ChromDictionary::size() const {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->names_.size();
+}
@@ -0,0 +1,80 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_CHROMDICTIONARY_HPP_
+#define DEPLOID_SRC_CHROMDICTIONARY_HPP_
+
+#include <stdint.h>  // uint32_t
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+
+/*! Small integer that stands for a chromosome name */
+typedef uint32_t ChromId;
+
+
+/*! \brief Process-wide table of chromosome names
+ *
+ *  Every reader interns the chromosome names it sees, so the same name has the
+ *  same ChromId in every VCF, panel and exclude list of the process, and the
+ *  chromosomes can be compared as integers. The ids follow the order in which
+ *  the names are first seen, ##contig header lines are interned before the
+ *  body so that a VCF with a complete header gives ids in contig order.
+ *
+ *  Names are never removed, and the string of an id never moves, so name()
+ *  can hand out a reference. All methods are thread safe.
+ */
+class ChromDictionary {
+#ifdef UNITTEST
+    friend class TestChromDictionary;
+#endif
+ public:
+    static ChromDictionary & global();
+
+    /*! Id of the name, the name is added if it is new */
+    ChromId intern(const string & name);
+    /*! Intern the ID of a "##contig=<ID=...>" header line, returns false if
+     *  the line is not a contig line */
+    bool internContigLine(const string & line);
+    /*! Look up a name without adding it */
+    bool find(const string & name, ChromId * id) const;
+    const string & name(const ChromId id) const;
+    size_t size() const;
+
+ private:
+    ChromDictionary() {}
+    ChromDictionary(const ChromDictionary &);
+    ChromDictionary & operator=(const ChromDictionary &);
+
+    mutable std::mutex mutex_;
+    std::unordered_map <string, ChromId> ids_;
+    // A deque keeps the strings in place as it grows
+    std::deque <string> names_;
+};
+
+#endif  // DEPLOID_SRC_CHROMDICTIONARY_HPP_
@@ -0,0 +1,93 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "chromSubset.hpp"
+
+
+ChromSubset::ChromSubset(const VariantIndex & sites,
+                         const vector <bool> & inSubset) {
+    assert(inSubset.size() == sites.chromId_.size());
+    this->sites_ = &sites;
+    this->inSubset_ = inSubset;
+    this->nSites_ = 0;
+    for (size_t chromI = 0; chromI < inSubset.size(); chromI++) {
+        if (!inSubset[chromI]) {
+            continue;
+        }
+        SiteRange range;
+        range.begin = sites.position_.offsets()[chromI];
+        range.end = sites.position_.offsets()[chromI + 1];
+        this->chromIndex_.push_back(chromI);
+        this->ranges_.push_back(range);
+        this->nSites_ += range.size();
+    }
+}
+
+
+ChromSubset::ChromSubset(const VariantIndex & sites,
+                         const vector <ChromId> & chromIds) {
+    vector <bool> inSubset(sites.chromId_.size(), false);
+    for (auto const &chromId : chromIds) {
+        size_t chromI = sites.findChrom(chromId);
+        if (chromI < inSubset.size()) {
+            inSubset[chromI] = true;
+        }
+    }
+    *this = ChromSubset(sites, inSubset);
+}
+
+
+ChromSubset ChromSubset::all(const VariantIndex & sites) {
+    return ChromSubset(sites, vector <bool>(sites.chromId_.size(), true));
+}
+
+
+ChromSubset ChromSubset::from(const VariantIndex & sites,
+                              const size_t firstChromI) {
+    vector <bool> inSubset(sites.chromId_.size(), false);
+    for (size_t chromI = firstChromI; chromI < inSubset.size(); chromI++) {
+        inSubset[chromI] = true;
+    }
+    return ChromSubset(sites, inSubset);
+}
+
+
+ChromSubset ChromSubset::complement() const {
+    vector <bool> inSubset(this->inSubset_);
+    inSubset.flip();
+    return ChromSubset(*this->sites_, inSubset);
+}
+
+
+vector <size_t> ChromSubset::siteIndices() const {
+    vector <size_t> indices;
+    indices.reserve(this->nSites_);
+    for (auto const &range : this->ranges_) {
+        for (size_t siteI = range.begin; siteI < range.end; siteI++) {
+            indices.push_back(siteI);
+        }
+    }
+    return indices;
+}
@@ -0,0 +1,84 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_CHROMSUBSET_HPP_
+#define DEPLOID_SRC_CHROMSUBSET_HPP_
+
+#include <vector>
+#include "variantIndex.hpp"
+
+using std::vector;
+
+/*! \brief Some of the chromosomes of a loaded reader, as ranges of its rows
+ *
+ *  Nothing is copied, each chromosome of the subset is the contiguous range
+ *  of sites it has in the reader, in reader order. A subset stays valid until
+ *  the sites of the reader change, and since it is read-only, several subsets
+ *  of one reader can be used from different threads, e.g. for hold-out or
+ *  per-chromosome analyses.
+ */
+class ChromSubset {
+#ifdef UNITTEST
+    friend class TestChromSubset;
+#endif
+ public:
+    /*! The chromosomes of sites with these ids, ids that sites does not have
+     *  are ignored */
+    ChromSubset(const VariantIndex & sites, const vector <ChromId> & chromIds);
+    ~ChromSubset() {}
+    static ChromSubset all(const VariantIndex & sites);
+    /*! Chromosomes whose index in the reader is at least firstChromI */
+    static ChromSubset from(const VariantIndex & sites,
+                            const size_t firstChromI);
+    /*! The chromosomes of the reader that are not in this subset */
+    ChromSubset complement() const;
+
+    size_t nChrom() const { return this->chromIndex_.size(); }
+    /*! Index in the reader of the i-th chromosome of the subset */
+    size_t chromIndex(const size_t i) const { return this->chromIndex_[i]; }
+    ChromId chromId(const size_t i) const {
+        return this->sites_->chromId_[this->chromIndex_[i]]; }
+    /*! Sites of the i-th chromosome of the subset */
+    const SiteRange & sites(const size_t i) const { return this->ranges_[i]; }
+    size_t nSites() const { return this->nSites_; }
+    bool containsChrom(const size_t chromI) const {
+        return this->inSubset_[chromI]; }
+    bool containsSite(const size_t siteI) const {
+        return this->inSubset_[this->sites_->chromIndexOfSite(siteI)]; }
+    /*! All sites of the subset, in increasing order */
+    vector <size_t> siteIndices() const;
+
+ private:
+    ChromSubset(const VariantIndex & sites, const vector <bool> & inSubset);
+
+    const VariantIndex * sites_;
+    // One flag per chromosome of the reader
+    vector <bool> inSubset_;
+    vector <size_t> chromIndex_;
+    vector <SiteRange> ranges_;
+    size_t nSites_;
+};
+
+#endif  // DEPLOID_SRC_CHROMSUBSET_HPP_
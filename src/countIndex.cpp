@@ -0,0 +1,150 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cassert>
+#include "countIndex.hpp"
+
+
+CountIndex::CountIndex(const VcfReader & vcf) : vcf_(vcf) {
+    Span <int32_t> refColumn = vcf.refCountColumn().raw();
+    Span <int32_t> altColumn = vcf.altCountColumn().raw();
+    size_t nSites = refColumn.size();
+    assert(nSites == vcf.nSites());
+    this->refPrefix_.assign(nSites + 1, 0);
+    this->altPrefix_.assign(nSites + 1, 0);
+    this->wsafPrefix_.assign(nSites + 1, 0.0);
+    this->coveredPrefix_.assign(nSites + 1, 0);
+    for (size_t i = 0; i < nSites; i++) {
+        int ref = refColumn[i];
+        int alt = altColumn[i];
+        bool covered = (ref + alt) > 0;
+        this->refPrefix_[i + 1] = this->refPrefix_[i] + ref;
+        this->altPrefix_[i + 1] = this->altPrefix_[i] + alt;
+        this->wsafPrefix_[i + 1] = this->wsafPrefix_[i] +
+            (covered ? static_cast<double>(alt) / (ref + alt) : 0.0);
+        this->coveredPrefix_[i + 1] = this->coveredPrefix_[i] +
+                                      (covered ? 1 : 0);
+    }
+}
+
+
+CountSummary CountIndex::summary(const SiteRange & sites) const {
+    assert(sites.begin <= sites.end && sites.end <= this->nSites());
+    CountSummary summary;
+    summary.nSites = sites.size();
+    summary.nCovered = this->coveredPrefix_[sites.end] -
+                       this->coveredPrefix_[sites.begin];
+    summary.refCount = this->refPrefix_[sites.end] -
+                       this->refPrefix_[sites.begin];
+    summary.altCount = this->altPrefix_[sites.end] -
+                       this->altPrefix_[sites.begin];
+    summary.wsafSum = this->wsafPrefix_[sites.end] -
+                      this->wsafPrefix_[sites.begin];
+    return summary;
+}
+
+
+CountSummary CountIndex::summary(const string & chrom, const int start,
+                                 const int end) const {
+    return this->summary(this->vcf_.range(chrom, start, end));
+}
+
+
+CountSummary CountIndex::chromSummary(const string & chrom) const {
+    SiteRange sites = {0, 0};
+    size_t chromI = this->vcf_.findChrom(chrom);
+    if (chromI < this->vcf_.chrom_.size()) {
+        sites.begin = this->vcf_.siteIndex(chromI, 0);
+        sites.end = sites.begin + this->vcf_.position_[chromI].size();
+    }
+    return this->summary(sites);
+}
+
+
+CountSummary CountIndex::summary(const ChromSubset & subset) const {
+    CountSummary summary = {0, 0, 0, 0, 0.0};
+    for (size_t i = 0; i < subset.nChrom(); i++) {
+        CountSummary chromSummary = this->summary(subset.sites(i));
+        summary.nSites += chromSummary.nSites;
+        summary.nCovered += chromSummary.nCovered;
+        summary.refCount += chromSummary.refCount;
+        summary.altCount += chromSummary.altCount;
+        summary.wsafSum += chromSummary.wsafSum;
+    }
+    return summary;
+}
+
+
+CountSummary CountIndex::total() const {
+    SiteRange sites = {0, this->nSites()};
+    return this->summary(sites);
+}
+
+
+vector <CountWindow> CountIndex::windows(const int windowSize) const {
+    assert(windowSize > 0);
+    vector <CountWindow> windows;
+    for (size_t chromI = 0; chromI < this->vcf_.chrom_.size(); chromI++) {
+        Span <int> positions = this->vcf_.position_[chromI];
+        if (positions.empty()) {
+            continue;
+        }
+        // Sites are sorted, so the windows are a sweep over the chromosome
+        size_t chromStart = this->vcf_.siteIndex(chromI, 0);
+        size_t posI = 0;
+        for (int start = 1; start <= positions.back(); start += windowSize) {
+            CountWindow window;
+            window.chrom = this->vcf_.chrom_[chromI];
+            window.start = start;
+            window.end = start + windowSize - 1;
+            SiteRange sites;
+            while (posI < positions.size() && positions[posI] < start) {
+                posI++;
+            }
+            sites.begin = chromStart + posI;
+            while (posI < positions.size() && positions[posI] <= window.end) {
+                posI++;
+            }
+            sites.end = chromStart + posI;
+            window.summary = this->summary(sites);
+            windows.push_back(window);
+        }
+    }
+    return windows;
+}
+
+
+void CountIndex::writeWindows(std::ostream & out,
+                              const int windowSize) const {
+    out << "CHROM\tSTART\tEND\tSITES\tREF\tALT\tMEAN_DEPTH\tMEAN_WSAF\n";
+    for (auto const &window : this->windows(windowSize)) {
+        out << window.chrom << "\t" << window.start << "\t" << window.end
+            << "\t" << window.summary.nSites
+            << "\t" << window.summary.refCount
+            << "\t" << window.summary.altCount
+            << "\t" << window.summary.meanDepth()
+            << "\t" << window.summary.meanWsaf() << "\n";
+    }
+}
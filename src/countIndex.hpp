@@ -0,0 +1,106 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_COUNTINDEX_HPP_
+#define DEPLOID_SRC_COUNTINDEX_HPP_
+
+#include <stdint.h>  // int64_t
+#include <ostream>
+#include <string>
+#include <vector>
+#include "chromSubset.hpp"
+#include "vcfReader.hpp"
+
+using std::vector;
+using std::string;
+
+/*! Allele counts summed over a set of sites */
+struct CountSummary {
+    size_t nSites;
+    // Sites with ref + alt > 0, the ones that have a WSAF
+    size_t nCovered;
+    int64_t refCount;
+    int64_t altCount;
+    // Sum of alt / (ref + alt) over the covered sites
+    double wsafSum;
+
+    int64_t depth() const { return this->refCount + this->altCount; }
+    double meanDepth() const {
+        return (this->nSites > 0) ?
+            static_cast<double>(this->depth()) / this->nSites : 0.0; }
+    double meanWsaf() const {
+        return (this->nCovered > 0) ? this->wsafSum / this->nCovered : 0.0; }
+};
+
+
+/*! One fixed-size window of a chromosome, start and end are included */
+struct CountWindow {
+    string chrom;
+    int start;
+    int end;
+    CountSummary summary;
+};
+
+
+/*! \brief Prefix sums over the allele counts of a loaded VcfReader
+ *
+ *  Built once, in one pass over the sites, then the sums, means and counts
+ *  of any genomic range take two binary searches for the range and O(1) for
+ *  the sums. The index refers to the sites of the reader when it was built,
+ *  it has to be built again after markers are removed.
+ */
+class CountIndex {
+#ifdef UNITTEST
+    friend class TestCountIndex;
+#endif
+ public:
+    explicit CountIndex(const VcfReader & vcf);
+    ~CountIndex() {}
+
+    size_t nSites() const { return this->refPrefix_.size() - 1; }
+    CountSummary summary(const SiteRange & sites) const;
+    CountSummary summary(const string & chrom, const int start,
+                         const int end) const;
+    CountSummary chromSummary(const string & chrom) const;
+    CountSummary summary(const ChromSubset & subset) const;
+    CountSummary total() const;
+
+    /*! Windows [1, windowSize], [windowSize + 1, 2 * windowSize], ... of
+     *  every chromosome, up to its last site. Windows without sites are
+     *  kept, so the windows of a chromosome tile it. */
+    vector <CountWindow> windows(const int windowSize) const;
+    /*! windows() as tab separated text with a header line */
+    void writeWindows(std::ostream & out, const int windowSize) const;
+
+ private:
+    const VcfReader & vcf_;
+    // Entry i is the sum over sites [0, i)
+    vector <int64_t> refPrefix_;
+    vector <int64_t> altPrefix_;
+    vector <double> wsafPrefix_;
+    vector <size_t> coveredPrefix_;
+};
+
+#endif  // DEPLOID_SRC_COUNTINDEX_HPP_
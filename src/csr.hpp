@@ -0,0 +1,185 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_CSR_HPP_
+#define DEPLOID_SRC_CSR_HPP_
+
+#include <algorithm>  // upper_bound
+#include <cassert>
+#include <vector>
+#include "threadPool.hpp"
+
+using std::vector;
+
+/*! \brief Read-only view of a contiguous range of values */
+template <class T>
+class Span {
+ public:
+    Span() : begin_(NULL), end_(NULL) {}
+    Span(const T * begin, const T * end) : begin_(begin), end_(end) {}
+
+    const T * begin() const { return this->begin_; }
+    const T * end() const { return this->end_; }
+    size_t size() const { return this->end_ - this->begin_; }
+    bool empty() const { return this->begin_ == this->end_; }
+    const T & operator[](size_t i) const { return this->begin_[i]; }
+    const T & front() const { return *this->begin_; }
+    const T & back() const { return *(this->end_ - 1); }
+
+ private:
+    const T * begin_;
+    const T * end_;
+};
+
+
+/*! \brief Read-only view of a compact column, e.g. int32 or float, that
+ *  reads its values as double */
+template <class T>
+class DoubleView {
+ public:
+    DoubleView() : begin_(NULL), end_(NULL) {}
+    explicit DoubleView(const vector <T> & column)
+        : begin_(column.data()), end_(column.data() + column.size()) {}
+
+    size_t size() const { return this->end_ - this->begin_; }
+    bool empty() const { return this->begin_ == this->end_; }
+    double operator[](size_t i) const {
+        return static_cast<double>(this->begin_[i]); }
+    /* The values as they are stored */
+    Span<T> raw() const { return Span<T>(this->begin_, this->end_); }
+    vector <double> toVector() const {
+        return vector <double>(this->begin_, this->end_); }
+
+ private:
+    const T * begin_;
+    const T * end_;
+};
+
+
+/*! \brief Compressed sparse rows: all values in one contiguous array, and an
+ *  offsets array where row i holds values [offsets[i], offsets[i+1]).
+ *
+ *  Used for the per-chromosome positions, where a row is a chromosome, the
+ *  offsets are the index of the chromosome starts and a flat value index is
+ *  the global site index.
+ */
+template <class T>
+class Csr {
+ public:
+    Csr() : offsets_(1, 0) {}
+
+    // Rows
+    size_t size() const {
+        return this->offsets_.empty() ? 0 : this->offsets_.size() - 1; }
+    bool empty() const { return this->size() == 0; }
+    Span<T> operator[](size_t row) const {
+        assert(row < this->size());
+        return Span<T>(this->values_.data() + this->offsets_[row],
+                       this->values_.data() + this->offsets_[row + 1]); }
+    Span<T> back() const { return (*this)[this->size() - 1]; }
+
+    // Flat values
+    size_t nValues() const { return this->values_.size(); }
+    const vector <T> & values() const { return this->values_; }
+    const vector <size_t> & offsets() const { return this->offsets_; }
+    size_t flatIndex(size_t row, size_t col) const {
+        return this->offsets_[row] + col; }
+    /*! Row that holds the flat value index, O(log rows) */
+    size_t rowOf(size_t flatIndex) const {
+        assert(flatIndex < this->nValues());
+        return std::upper_bound(this->offsets_.begin(), this->offsets_.end(),
+                                flatIndex) - this->offsets_.begin() - 1; }
+
+    // Building
+    void clear() {
+        this->values_.clear();
+        this->offsets_.assign(1, 0);
+    }
+    void reserve(size_t nRows, size_t nValues) {
+        this->offsets_.reserve(nRows + 1);
+        this->values_.reserve(nValues);
+    }
+    /*! Start a new, empty, row */
+    void newRow() {
+        if (this->offsets_.empty()) {
+            this->offsets_.push_back(0);
+        }
+        this->offsets_.push_back(this->values_.size());
+    }
+    /*! Append a value to the last row */
+    void append(const T & value) {
+        assert(this->size() > 0);
+        this->values_.push_back(value);
+        this->offsets_.back() = this->values_.size();
+    }
+    template <class Iterator>
+    void append(Iterator first, Iterator last) {
+        assert(this->size() > 0);
+        this->values_.insert(this->values_.end(), first, last);
+        this->offsets_.back() = this->values_.size();
+    }
+    void push_back(const vector <T> & row) {
+        this->newRow();
+        this->append(row.begin(), row.end());
+    }
+
+    /*! Stable in-place compaction, keeps values index[row][i] of each row.
+     *  With a pool the rows are first compacted to the front of their own
+     *  range at the same time, then moved down into place in row order. */
+    void keepInPlace(const Csr <size_t> & index, ThreadPool * pool = NULL) {
+        assert(index.size() == this->size());
+        bool compacted = pool != NULL && pool->nThreads() > 1;
+        if (compacted) {
+            pool->parallelFor(this->size(), [this, &index](size_t row) {
+                size_t rowStart = this->offsets_[row];
+                size_t nKept = 0;
+                for (auto const &col : index[row]) {
+                    this->values_[rowStart + nKept++] =
+                        this->values_[rowStart + col];
+                }
+            });
+        }
+        size_t nKept = 0;
+        for (size_t row = 0; row < this->size(); row++) {
+            size_t rowStart = this->offsets_[row];
+            this->offsets_[row] = nKept;
+            Span <size_t> kept = index[row];
+            for (size_t i = 0; i < kept.size(); i++) {
+                // After the parallel pass the kept values are at the front
+                size_t col = compacted ? i : kept[i];
+                assert(rowStart + col >= nKept);
+                this->values_[nKept++] = this->values_[rowStart + col];
+            }
+        }
+        this->offsets_.back() = nKept;
+        this->values_.resize(nKept);
+    }
+
+ private:
+    vector <T> values_;
+    vector <size_t> offsets_;
+};
+
+#endif  // DEPLOID_SRC_CSR_HPP_
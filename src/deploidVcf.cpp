@@ -0,0 +1,292 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cstring>  // memcpy
+#include <exception>
+#include <string>
+#include "deploidVcf.h"
+#include "txtReader.hpp"
+#include "vcfReader.hpp"
+
+using std::string;
+
+static_assert(sizeof(int) == sizeof(int32_t),
+              "positions are handed out as int32_t");
+
+struct dvcf_vcf {
+    VcfReader reader;
+};
+
+struct dvcf_txt {
+    TxtReader reader;
+};
+
+
+/*! \brief Reads the private members of the readers for the C interface */
+class DvcfAccess {
+ public:
+    static const VariantIndex & index(const dvcf_vcf * vcf) {
+        return vcf->reader; }
+    static const VariantIndex & index(const dvcf_txt * txt) {
+        return txt->reader; }
+    static const vector <string> & chrom(const VariantIndex & index) {
+        return index.chrom_; }
+    static const Csr <int> & position(const VariantIndex & index) {
+        return index.position_; }
+    static const vector <string> & header(const TxtReader & reader) {
+        return reader.header_; }
+    static const vector <double> & info(const TxtReader & reader) {
+        return reader.info_; }
+};
+
+
+namespace {
+
+thread_local string lastError;
+
+int fail(const char * what) {
+    lastError = what;
+    return DVCF_ERROR;
+}
+
+template <class Handle>
+size_t nChrom(const Handle * handle) {
+    return DvcfAccess::chrom(DvcfAccess::index(handle)).size();
+}
+
+template <class Handle>
+const char * chrom(const Handle * handle, size_t c) {
+    const vector <string> & names = DvcfAccess::chrom(
+                                        DvcfAccess::index(handle));
+    return c < names.size() ? names[c].c_str() : NULL;
+}
+
+// The offsets are exported as fixed width integers without a copy
+static_assert(sizeof(size_t) == sizeof(uint64_t),
+              "chromosome offsets are exported as uint64_t");
+
+template <class Handle>
+const uint64_t * chromOffsets(const Handle * handle) {
+    return reinterpret_cast<const uint64_t *>(DvcfAccess::position(
+        DvcfAccess::index(handle)).offsets().data());
+}
+
+template <class Handle>
+const int32_t * positions(const Handle * handle) {
+    return DvcfAccess::position(DvcfAccess::index(handle)).values().data();
+}
+
+}  // namespace
+
+
+int dvcf_abi_version(void) {
+    return DVCF_ABI_VERSION;
+}
+
+
+const char * dvcf_last_error(void) {
+    return lastError.c_str();
+}
+
+
+int dvcf_vcf_open(const char * fileName, const char * sampleName,
+                  int extractPlaf, dvcf_vcf ** vcf) {
+    *vcf = NULL;
+    if (fileName == NULL) {
+        return fail("fileName is NULL");
+    }
+    dvcf_vcf * handle = NULL;
+    try {
+        handle = new dvcf_vcf;
+        handle->reader.open(fileName, sampleName ? sampleName : "",
+                            extractPlaf != 0);
+    } catch (const std::exception & e) {
+        delete handle;
+        return fail(e.what());
+    } catch (...) {
+        delete handle;
+        return fail("unknown error");
+    }
+    *vcf = handle;
+    return DVCF_OK;
+}
+
+
+void dvcf_vcf_free(dvcf_vcf * vcf) {
+    delete vcf;
+}
+
+
+size_t dvcf_vcf_n_sites(const dvcf_vcf * vcf) {
+    return vcf->reader.nSites();
+}
+
+
+size_t dvcf_vcf_n_header_lines(const dvcf_vcf * vcf) {
+    return vcf->reader.headerLines.size();
+}
+
+
+const char * dvcf_vcf_header_line(const dvcf_vcf * vcf, size_t i) {
+    const vector <string> & lines = vcf->reader.headerLines;
+    return i < lines.size() ? lines[i].c_str() : NULL;
+}
+
+
+const int32_t * dvcf_vcf_ref_count(const dvcf_vcf * vcf) {
+    return vcf->reader.refCountColumn().raw().begin();
+}
+
+
+const int32_t * dvcf_vcf_alt_count(const dvcf_vcf * vcf) {
+    return vcf->reader.altCountColumn().raw().begin();
+}
+
+
+const double * dvcf_vcf_vqslod(const dvcf_vcf * vcf) {
+    return vcf->reader.vqslodColumn().raw().begin();
+}
+
+
+const float * dvcf_vcf_plaf(const dvcf_vcf * vcf) {
+    return vcf->reader.plafColumn().raw().begin();
+}
+
+
+size_t dvcf_vcf_n_chrom(const dvcf_vcf * vcf) {
+    return nChrom(vcf);
+}
+
+
+const char * dvcf_vcf_chrom(const dvcf_vcf * vcf, size_t c) {
+    return chrom(vcf, c);
+}
+
+
+const uint64_t * dvcf_vcf_chrom_offsets(const dvcf_vcf * vcf) {
+    return chromOffsets(vcf);
+}
+
+
+const int32_t * dvcf_vcf_positions(const dvcf_vcf * vcf) {
+    return positions(vcf);
+}
+
+
+int dvcf_txt_open(const char * fileName, dvcf_txt ** txt) {
+    *txt = NULL;
+    if (fileName == NULL) {
+        return fail("fileName is NULL");
+    }
+    dvcf_txt * handle = NULL;
+    try {
+        handle = new dvcf_txt;
+        handle->reader.readFromFile(fileName);
+    } catch (const std::exception & e) {
+        delete handle;
+        return fail(e.what());
+    } catch (...) {
+        delete handle;
+        return fail("unknown error");
+    }
+    *txt = handle;
+    return DVCF_OK;
+}
+
+
+void dvcf_txt_free(dvcf_txt * txt) {
+    delete txt;
+}
+
+
+size_t dvcf_txt_n_sites(const dvcf_txt * txt) {
+    return txt->reader.content_.size();
+}
+
+
+size_t dvcf_txt_n_chrom(const dvcf_txt * txt) {
+    return nChrom(txt);
+}
+
+
+const char * dvcf_txt_chrom(const dvcf_txt * txt, size_t c) {
+    return chrom(txt, c);
+}
+
+
+const uint64_t * dvcf_txt_chrom_offsets(const dvcf_txt * txt) {
+    return chromOffsets(txt);
+}
+
+
+const int32_t * dvcf_txt_positions(const dvcf_txt * txt) {
+    return positions(txt);
+}
+
+
+size_t dvcf_txt_n_columns(const dvcf_txt * txt) {
+    const vector < vector <double> > & content = txt->reader.content_;
+    return content.empty() ? DvcfAccess::header(txt->reader).size() :
+                             content[0].size();
+}
+
+
+const char * dvcf_txt_column_name(const dvcf_txt * txt, size_t j) {
+    const vector <string> & header = DvcfAccess::header(txt->reader);
+    return j < header.size() ? header[j].c_str() : NULL;
+}
+
+
+const double * dvcf_txt_info(const dvcf_txt * txt) {
+    const vector <double> & info = DvcfAccess::info(txt->reader);
+    return info.empty() ? NULL : info.data();
+}
+
+
+const double * dvcf_txt_row(const dvcf_txt * txt, size_t i) {
+    const vector < vector <double> > & content = txt->reader.content_;
+    return i < content.size() ? content[i].data() : NULL;
+}
+
+
+int dvcf_txt_copy_matrix(const dvcf_txt * txt, double * matrix,
+                         size_t capacity) {
+    const vector < vector <double> > & content = txt->reader.content_;
+    size_t nColumns = dvcf_txt_n_columns(txt);
+    if (capacity < content.size() * nColumns) {
+        return fail("matrix capacity is smaller than nSites * nColumns");
+    }
+    // Checked before copying, a ragged file leaves the matrix untouched
+    for (auto const &row : content) {
+        if (row.size() != nColumns) {
+            return fail("rows of the matrix differ in length");
+        }
+    }
+    for (auto const &row : content) {
+        std::memcpy(matrix, row.data(), nColumns * sizeof(double));
+        matrix += nColumns;
+    }
+    return DVCF_OK;
+}
@@ -0,0 +1,114 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*! \file deploidVcf.h
+ *  \brief C interface of libdeploidvcf, for Python and R bindings
+ *
+ *  Readers are opaque handles. Columns are handed out as a pointer and a
+ *  length into the memory of the reader, nothing is copied: the pointers
+ *  are borrowed, and are valid until the reader is freed. The layout of
+ *  every column is fixed, counts are int32, PLAF float, and VQSLOD, the
+ *  matrix and the info values double, so a binding can wrap them as numpy
+ *  arrays or R vectors as they are.
+ *
+ *  Functions that can fail return DVCF_OK or DVCF_ERROR, the message of the
+ *  last error of the calling thread is dvcf_last_error(). New functions may
+ *  be added, the ones here keep their signatures while DVCF_ABI_VERSION
+ *  stays the same.
+ */
+
+#ifndef DEPLOID_SRC_DEPLOIDVCF_H_
+#define DEPLOID_SRC_DEPLOIDVCF_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DVCF_ABI_VERSION 1
+
+#if defined(__GNUC__)
+#define DVCF_API __attribute__((visibility("default")))
+#else
+#define DVCF_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum { DVCF_OK = 0, DVCF_ERROR = 1 };
+
+typedef struct dvcf_vcf dvcf_vcf;
+typedef struct dvcf_txt dvcf_txt;
+
+DVCF_API int dvcf_abi_version(void);
+DVCF_API const char * dvcf_last_error(void);
+
+/* VCF of one sample, extractPlaf reads PLAF from the AF field of INFO */
+DVCF_API int dvcf_vcf_open(const char * fileName, const char * sampleName,
+                           int extractPlaf, dvcf_vcf ** vcf);
+DVCF_API void dvcf_vcf_free(dvcf_vcf * vcf);
+DVCF_API size_t dvcf_vcf_n_sites(const dvcf_vcf * vcf);
+DVCF_API size_t dvcf_vcf_n_header_lines(const dvcf_vcf * vcf);
+DVCF_API const char * dvcf_vcf_header_line(const dvcf_vcf * vcf, size_t i);
+/* Columns of nSites values */
+DVCF_API const int32_t * dvcf_vcf_ref_count(const dvcf_vcf * vcf);
+DVCF_API const int32_t * dvcf_vcf_alt_count(const dvcf_vcf * vcf);
+DVCF_API const double * dvcf_vcf_vqslod(const dvcf_vcf * vcf);
+DVCF_API const float * dvcf_vcf_plaf(const dvcf_vcf * vcf);
+/* Sites as compressed sparse rows: chromosome c holds the positions
+ * [offsets[c], offsets[c + 1]), there are nChrom + 1 offsets */
+DVCF_API size_t dvcf_vcf_n_chrom(const dvcf_vcf * vcf);
+DVCF_API const char * dvcf_vcf_chrom(const dvcf_vcf * vcf, size_t c);
+DVCF_API const uint64_t * dvcf_vcf_chrom_offsets(const dvcf_vcf * vcf);
+DVCF_API const int32_t * dvcf_vcf_positions(const dvcf_vcf * vcf);
+
+/* Text inputs: ref, alt and PLAF files, panels and exclude lists */
+DVCF_API int dvcf_txt_open(const char * fileName, dvcf_txt ** txt);
+DVCF_API void dvcf_txt_free(dvcf_txt * txt);
+DVCF_API size_t dvcf_txt_n_sites(const dvcf_txt * txt);
+DVCF_API size_t dvcf_txt_n_chrom(const dvcf_txt * txt);
+DVCF_API const char * dvcf_txt_chrom(const dvcf_txt * txt, size_t c);
+DVCF_API const uint64_t * dvcf_txt_chrom_offsets(const dvcf_txt * txt);
+DVCF_API const int32_t * dvcf_txt_positions(const dvcf_txt * txt);
+/* Column names after CHROM and POS, e.g. the strains of a panel */
+DVCF_API size_t dvcf_txt_n_columns(const dvcf_txt * txt);
+DVCF_API const char * dvcf_txt_column_name(const dvcf_txt * txt, size_t j);
+/* Single column files, e.g. ref, alt and PLAF, nSites values, NULL for a
+ * matrix */
+DVCF_API const double * dvcf_txt_info(const dvcf_txt * txt);
+/* Row i of the matrix, nColumns values. The rows are separate blocks of
+ * memory and the matrix is not available as one block. A binding that
+ * needs one row major array, e.g. for numpy or R, copies it with
+ * dvcf_txt_copy_matrix(), which fails if the rows do not all have nColumns
+ * values. */
+DVCF_API const double * dvcf_txt_row(const dvcf_txt * txt, size_t i);
+DVCF_API int dvcf_txt_copy_matrix(const dvcf_txt * txt, double * matrix,
+                                  size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // DEPLOID_SRC_DEPLOIDVCF_H_
@@ -183,6 +183,15 @@ struct InvalidInputFile : public InvalidInput{
 };
 
 
+struct InvalidBinaryPanel : public InvalidInput{
+  explicit InvalidBinaryPanel(string str1, string str2):InvalidInput(str1) {
+    this->reason = "Invalid binary panel: ";
+    throwMsg = this->reason + this->src + ", " + str2;
+  }
+  ~InvalidBinaryPanel() throw() {}
+};
+
+
 struct FileNameMissing : public InvalidInput{
   explicit FileNameMissing(string str):InvalidInput(str) {
     this->reason = " file path missing!";
@@ -241,6 +250,15 @@ struct LociNumberUnequal : public InvalidInput{
 };
 
 
+struct ContigMismatch : public InvalidInput{
+  explicit ContigMismatch(string str1, string str2):InvalidInput(str1) {
+    this->reason = "Contig header lines differ from the ones of ";
+    throwMsg = this->reason + str2 + " in: " + this->src;
+  }
+  ~ContigMismatch() throw() {}
+};
+
+
 struct SumOfPropNotOne : public InvalidInput{
   explicit SumOfPropNotOne(string str):InvalidInput(str) {
     this->reason = "Sum of initial proportion is not equal to 1, but equals ";
@@ -0,0 +1,417 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <zlib.h>       // inflate, compress2, crc32
+#include <algorithm>    // min
+#include <cstdio>       // FILE, rename
+#include <cstring>      // memcpy, memcmp
+#include <fstream>
+#include <iostream>
+#include <iterator>     // istreambuf_iterator
+#include "exceptions.hpp"
+#include "global.hpp"
+#include "gzIndex.hpp"
+
+using std::endl;
+
+const char GzIndex::magic_[8] = {'D', 'E', 'P', 'L', 'O', 'I', 'D', 'G'};
+const uint64_t GzIndex::defaultSpan_;
+const uint32_t GzIndex::windowSize_;
+
+
+namespace {
+
+// Bytes of the file read at a time
+const size_t chunkSize = 1 << 16;
+
+/*! Fixed size start of a sidecar, followed by the access points, each with
+ *  its window compressed, and a crc32 of all of it */
+struct SidecarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nPoints;
+    uint64_t fileSize;
+    int64_t modified;
+    uint32_t headCrc;
+    uint32_t tailCrc;
+    uint64_t span;
+    uint64_t outSize;
+};
+
+
+struct PointHeader {
+    uint64_t in;
+    uint64_t out;
+    int32_t bits;
+    uint32_t windowSize;
+    uint64_t compressedSize;
+};
+
+
+template <class T>
+void append(string * bytes, const T & value) {
+    bytes->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+
+template <class T>
+bool take(const string & bytes, size_t * cursor, T * value) {
+    if (*cursor + sizeof(T) > bytes.size()) {
+        return false;
+    }
+    memcpy(value, bytes.data() + *cursor, sizeof(T));
+    *cursor += sizeof(T);
+    return true;
+}
+
+
+uint32_t crcOf(const char * data, size_t size) {
+    return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0),
+        reinterpret_cast<const Bytef *>(data), size));
+}
+
+
+/*! Closes the file and ends the inflate stream on every way out */
+struct InflateState {
+    FILE * file;
+    z_stream strm;
+    bool started;
+
+    InflateState() : file(NULL), started(false) {
+        memset(&this->strm, 0, sizeof(this->strm));
+    }
+    ~InflateState() {
+        if (this->started) {
+            inflateEnd(&this->strm);
+        }
+        if (this->file != NULL) {
+            fclose(this->file);
+        }
+    }
+};
+
+}  // namespace
+
+
+bool GzIndex::loadOrBuild(const string & fileName, const size_t nHeaderLines,
+                          LineIndex * lines) {
+    FileFingerprint fingerprint;
+    if (!fingerprint.of(fileName) || !fingerprint.isGzip) {
+        return false;
+    }
+    if (this->read(fileName) && lines->read(fileName, nHeaderLines)) {
+        return true;
+    }
+    if (!this->build(fileName, nHeaderLines, lines)) {
+        return false;
+    }
+    if (!this->write(fileName) || !lines->write(fileName)) {
+        dout << " Gzip index of " << fileName << " not written" << endl;
+    }
+    return true;
+}
+
+
+bool GzIndex::build(const string & fileName, const size_t nHeaderLines,
+                    LineIndex * lines) {
+    FileFingerprint fingerprint;
+    InflateState state;
+    state.file = fopen(fileName.c_str(), "rb");
+    if (!fingerprint.of(fileName) || state.file == NULL) {
+        throw InvalidInputFile(fileName);
+    }
+    // 47 inflates gzip or zlib data, Z_BLOCK stops at every block boundary
+    z_stream & strm = state.strm;
+    if (inflateInit2(&strm, 47) != Z_OK) {
+        throw InvalidInputFile(fileName);
+    }
+    state.started = true;
+    if (lines != NULL) {
+        lines->startScan(nHeaderLines);
+    }
+
+    vector <unsigned char> input(chunkSize);
+    // The last windowSize_ bytes of inflated data, used as a ring
+    vector <unsigned char> window(windowSize_);
+    vector <GzAccessPoint> points;
+    uint64_t totalIn = 0;
+    uint64_t totalOut = 0;
+    uint64_t last = 0;
+    int ret = Z_OK;
+    strm.avail_out = 0;
+    do {
+        strm.avail_in = fread(input.data(), 1, input.size(), state.file);
+        if (strm.avail_in == 0) {
+            throw InvalidInputFile(fileName);
+        }
+        strm.next_in = input.data();
+        do {
+            if (strm.avail_out == 0) {
+                strm.avail_out = windowSize_;
+                strm.next_out = window.data();
+            }
+            unsigned char * produced = strm.next_out;
+            totalIn += strm.avail_in;
+            totalOut += strm.avail_out;
+            ret = inflate(&strm, Z_BLOCK);
+            totalIn -= strm.avail_in;
+            totalOut -= strm.avail_out;
+            if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
+                    ret == Z_MEM_ERROR) {
+                throw InvalidInputFile(fileName);
+            }
+            if (lines != NULL) {
+                lines->scan(reinterpret_cast<const char *>(produced),
+                            strm.next_out - produced);
+            }
+            if (ret == Z_STREAM_END) {
+                break;
+            }
+            // At the end of a block that is not the last one
+            if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+                    (totalOut == 0 || totalOut - last > this->span_)) {
+                GzAccessPoint point;
+                point.in = totalIn;
+                point.out = totalOut;
+                point.bits = strm.data_type & 7;
+                // Unrolled from the ring, oldest byte first
+                size_t left = strm.avail_out;
+                point.window.assign(window.begin() + windowSize_ - left,
+                                    window.end());
+                point.window.append(window.begin(),
+                                    window.begin() + windowSize_ - left);
+                size_t nKept = std::min(totalOut,
+                                        static_cast<uint64_t>(windowSize_));
+                point.window.erase(0, windowSize_ - nKept);
+                points.push_back(point);
+                last = totalOut;
+            }
+        } while (strm.avail_in != 0);
+    } while (ret != Z_STREAM_END);
+
+    // Another member follows, e.g. a block of bgzip output
+    if (strm.avail_in != 0 || fgetc(state.file) != EOF) {
+        dout << " " << fileName << " has more than one gzip member" << endl;
+        return false;
+    }
+    if (lines != NULL) {
+        lines->finishScan(fingerprint);
+    }
+    this->fingerprint_ = fingerprint;
+    this->outSize_ = totalOut;
+    this->points_.swap(points);
+    dout << " Indexed " << this->points_.size() << " access points of "
+         << fileName << endl;
+    return true;
+}
+
+
+void GzIndex::extract(const string & fileName, uint64_t begin, uint64_t end,
+                      string * bytes) const {
+    bytes->clear();
+    if (end > this->outSize_ || begin > end || this->points_.empty()) {
+        throw InvalidInputFile(fileName);
+    }
+    if (begin == end) {
+        return;
+    }
+    // The last point at or before begin
+    size_t pointI = 0;
+    while (pointI + 1 < this->points_.size() &&
+           this->points_[pointI + 1].out <= begin) {
+        pointI++;
+    }
+    const GzAccessPoint & point = this->points_[pointI];
+
+    InflateState state;
+    state.file = fopen(fileName.c_str(), "rb");
+    z_stream & strm = state.strm;
+    if (state.file == NULL || inflateInit2(&strm, -15) != Z_OK) {
+        throw InvalidInputFile(fileName);
+    }
+    state.started = true;
+    // A point in the middle of a byte starts with its last bits
+    off_t start = static_cast<off_t>(point.in - (point.bits ? 1 : 0));
+    if (fseeko(state.file, start, SEEK_SET) != 0) {
+        throw InvalidInputFile(fileName);
+    }
+    if (point.bits) {
+        int byte = fgetc(state.file);
+        if (byte == EOF) {
+            throw InvalidInputFile(fileName);
+        }
+        inflatePrime(&strm, point.bits, byte >> (8 - point.bits));
+    }
+    if (!point.window.empty()) {
+        inflateSetDictionary(&strm,
+            reinterpret_cast<const Bytef *>(point.window.data()),
+            point.window.size());
+    }
+
+    vector <unsigned char> input(chunkSize);
+    vector <unsigned char> output(chunkSize);
+    uint64_t skip = begin - point.out;
+    size_t wanted = end - begin;
+    bytes->reserve(wanted);
+    int ret = Z_OK;
+    while (bytes->size() < wanted && ret != Z_STREAM_END) {
+        if (strm.avail_in == 0) {
+            strm.avail_in = fread(input.data(), 1, input.size(), state.file);
+            if (strm.avail_in == 0) {
+                throw InvalidInputFile(fileName);
+            }
+            strm.next_in = input.data();
+        }
+        strm.avail_out = output.size();
+        strm.next_out = output.data();
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
+                ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR) {
+            throw InvalidInputFile(fileName);
+        }
+        size_t produced = output.size() - strm.avail_out;
+        size_t skipped = std::min(skip, static_cast<uint64_t>(produced));
+        skip -= skipped;
+        size_t nTaken = std::min(produced - skipped, wanted - bytes->size());
+        bytes->append(reinterpret_cast<const char *>(output.data()) + skipped,
+                      nTaken);
+    }
+    if (bytes->size() < wanted) {
+        throw InvalidInputFile(fileName);
+    }
+}
+
+
+bool GzIndex::write(const string & fileName) const {
+    SidecarHeader header;
+    memcpy(header.magic, GzIndex::magic_, 8);
+    header.version = GzIndex::version_;
+    header.nPoints = this->points_.size();
+    header.fileSize = this->fingerprint_.fileSize;
+    header.modified = this->fingerprint_.modified;
+    header.headCrc = this->fingerprint_.headCrc;
+    header.tailCrc = this->fingerprint_.tailCrc;
+    header.span = this->span_;
+    header.outSize = this->outSize_;
+
+    string bytes;
+    append(&bytes, header);
+    for (auto const &point : this->points_) {
+        // The windows are most of the sidecar, and compress well
+        uLongf compressedSize = compressBound(point.window.size());
+        string compressed(compressedSize, '\0');
+        if (compress2(reinterpret_cast<Bytef *>(&compressed[0]),
+                      &compressedSize,
+                      reinterpret_cast<const Bytef *>(point.window.data()),
+                      point.window.size(), Z_BEST_COMPRESSION) != Z_OK) {
+            return false;
+        }
+        PointHeader pointHeader = {point.in, point.out, point.bits,
+            static_cast<uint32_t>(point.window.size()), compressedSize};
+        append(&bytes, pointHeader);
+        bytes.append(compressed.data(), compressedSize);
+    }
+    append(&bytes, crcOf(bytes.data(), bytes.size()));
+
+    // Written aside and moved in place, a reader never sees half a sidecar
+    string sidecar = GzIndex::sidecarName(fileName);
+    string partial = sidecar + ".tmp";
+    std::ofstream out(partial.c_str(), std::ios::out | std::ios::binary |
+                                       std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if (out.fail() || std::rename(partial.c_str(), sidecar.c_str()) != 0) {
+        std::remove(partial.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool GzIndex::read(const string & fileName) {
+    std::ifstream in(GzIndex::sidecarName(fileName).c_str(),
+                     std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        return false;
+    }
+    string bytes((std::istreambuf_iterator<char>(in)),
+                 std::istreambuf_iterator<char>());
+    uint32_t crc;
+    if (bytes.size() < sizeof(SidecarHeader) + sizeof(crc)) {
+        return false;
+    }
+    size_t body = bytes.size() - sizeof(crc);
+    memcpy(&crc, bytes.data() + body, sizeof(crc));
+    if (crc != crcOf(bytes.data(), body)) {
+        return false;
+    }
+    bytes.resize(body);
+
+    size_t cursor = 0;
+    SidecarHeader header;
+    take(bytes, &cursor, &header);
+    FileFingerprint fingerprint;
+    fingerprint.fileSize = header.fileSize;
+    fingerprint.modified = header.modified;
+    fingerprint.headCrc = header.headCrc;
+    fingerprint.tailCrc = header.tailCrc;
+    FileFingerprint now;
+    if (memcmp(header.magic, GzIndex::magic_, 8) != 0 ||
+            header.version != GzIndex::version_ ||
+            !now.of(fileName) || !(now == fingerprint)) {
+        return false;
+    }
+
+    vector <GzAccessPoint> points(header.nPoints);
+    for (auto &point : points) {
+        PointHeader pointHeader;
+        if (!take(bytes, &cursor, &pointHeader) ||
+                pointHeader.windowSize > windowSize_ ||
+                cursor + pointHeader.compressedSize > bytes.size()) {
+            return false;
+        }
+        point.in = pointHeader.in;
+        point.out = pointHeader.out;
+        point.bits = pointHeader.bits;
+        point.window.resize(pointHeader.windowSize);
+        uLongf windowSize = pointHeader.windowSize;
+        if (pointHeader.windowSize > 0 &&
+                (uncompress(reinterpret_cast<Bytef *>(&point.window[0]),
+                            &windowSize,
+                            reinterpret_cast<const Bytef *>(bytes.data() +
+                                                            cursor),
+                            pointHeader.compressedSize) != Z_OK ||
+                 windowSize != pointHeader.windowSize)) {
+            return false;
+        }
+        cursor += pointHeader.compressedSize;
+    }
+
+    this->fingerprint_ = now;
+    this->span_ = header.span;
+    this->outSize_ = header.outSize;
+    this->points_.swap(points);
+    return true;
+}
@@ -0,0 +1,111 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_GZINDEX_HPP_
+#define DEPLOID_SRC_GZINDEX_HPP_
+
+#include <stdint.h>  // uint64_t
+#include <string>
+#include <vector>
+#include "lineIndex.hpp"
+
+using std::string;
+using std::vector;
+
+/*! Where inflating can start in the middle of a gzipped file: the bit
+ *  position in the file, the offset in the inflated data and the inflated
+ *  bytes before it that later data may refer back to */
+struct GzAccessPoint {
+    uint64_t in;
+    uint64_t out;
+    int32_t bits;
+    string window;
+};
+
+
+/*! \brief Access points of a gzipped file, kept in a sidecar file next to
+ *  it, as in zlib's examples/zran.c
+ *
+ *  A point is taken at the first deflate block boundary after every span
+ *  bytes of inflated data. Bytes at any offset of the inflated data are
+ *  then read by inflating from the point before them, so the chunks of a
+ *  file can be inflated at the same time, and a reader can seek to the
+ *  lines of a chromosome that a LineIndex of the inflated data finds.
+ *
+ *  Only files of a single gzip member are indexed. Files of several
+ *  members, e.g. bgzip output, are left to the stream readers. The sidecar
+ *  is fileName + ".gzidx".
+ */
+class GzIndex {
+#ifdef UNITTEST
+    friend class TestGzIndex;
+#endif
+ public:
+    static const char magic_[8];
+    static const uint32_t version_ = 1;
+    static const uint64_t defaultSpan_ = 1 << 20;
+    static const uint32_t windowSize_ = 1 << 15;
+
+    GzIndex() : span_(defaultSpan_), outSize_(0) {}
+
+    static string sidecarName(const string & fileName) {
+        return fileName + ".gzidx"; }
+    /* Inflated bytes between access points of the next build() */
+    void setSpan(const uint64_t span) { this->span_ = span; }
+
+    /*! The access points and the line index of a gzipped file, read from
+     *  their sidecars when they are up to date, else built in one pass over
+     *  the file and written to the sidecars. False for plain files and for
+     *  files of several gzip members. */
+    bool loadOrBuild(const string & fileName, const size_t nHeaderLines,
+                     LineIndex * lines);
+    /*! Inflate the file once for its access points, and scan the inflated
+     *  data into lines when it is not NULL. False, and lines left
+     *  unfinished, if the file has more than one gzip member. Throws
+     *  InvalidInputFile if the file can not be inflated. */
+    bool build(const string & fileName, const size_t nHeaderLines = 0,
+               LineIndex * lines = NULL);
+    /*! False if the sidecar is missing, corrupted or out of date */
+    bool read(const string & fileName);
+    bool write(const string & fileName) const;
+
+    size_t nPoints() const { return this->points_.size(); }
+    uint64_t outSize() const { return this->outSize_; }
+
+    /*! Bytes [begin, end) of the inflated data, safe to call from several
+     *  threads at once */
+    void extract(const string & fileName, uint64_t begin, uint64_t end,
+                 string * bytes) const;
+
+ private:
+    // What the index was built from
+    FileFingerprint fingerprint_;
+    uint64_t span_;
+    // Size of the inflated data
+    uint64_t outSize_;
+    vector <GzAccessPoint> points_;
+};
+
+#endif  // DEPLOID_SRC_GZINDEX_HPP_
@@ -62,6 +62,8 @@ gzstreambuf* gzstreambuf::open( const char* name, int open_mode) {
     if (file == 0)
         return (gzstreambuf*)0;
     opened = 1;
+    // drop what is left in the buffer from a previously opened file
+    setg( buffer + 4, buffer + 4, buffer + 4);
     return this;
 }
 
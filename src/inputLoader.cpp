@@ -0,0 +1,103 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <functional>
+#include <iostream>
+#include "inputLoader.hpp"
+#include "threadPool.hpp"
+
+
+void InputLoader::setVcf(const string & fileName, const string & sampleName,
+                         const bool extractPlaf) {
+    this->vcfFileName_ = fileName;
+    this->sampleName_ = sampleName;
+    this->extractPlaf_ = extractPlaf;
+}
+
+
+void InputLoader::setRef(const string & fileName, TxtReader * reader) {
+    this->setText(REF, fileName, reader);
+}
+
+
+void InputLoader::setAlt(const string & fileName, TxtReader * reader) {
+    this->setText(ALT, fileName, reader);
+}
+
+
+void InputLoader::setPlaf(const string & fileName, TxtReader * reader) {
+    this->setText(PLAF, fileName, reader);
+}
+
+
+void InputLoader::setPanel(const string & fileName, TxtReader * reader) {
+    this->setText(PANEL, fileName, reader);
+}
+
+
+void InputLoader::setExclude(const string & fileName,
+                             ExcludeMarker * reader) {
+    this->setText(EXCLUDE, fileName, reader);
+}
+
+
+void InputLoader::setText(const TextInput input, const string & fileName,
+                          TxtReader * reader) {
+    TextSlot & slot = this->text_[input];
+    slot.fileName = fileName;
+    if (reader != NULL) {
+        slot.owned.reset();
+        slot.reader = reader;
+    } else {
+        slot.owned.reset((input == EXCLUDE) ? new ExcludeMarker() :
+                                              new TxtReader());
+        slot.reader = slot.owned.get();
+    }
+}
+
+
+void InputLoader::load() {
+    // One task per input, in the order their errors take precedence
+    vector < std::function<void()> > loads;
+    if (!this->vcfFileName_.empty()) {
+        loads.push_back([this]() {
+            this->vcf_.reset(new VcfReader(this->vcfFileName_,
+                                           this->sampleName_,
+                                           this->extractPlaf_));
+        });
+    }
+    for (size_t input = 0; input < N_TEXT_INPUTS; input++) {
+        TextSlot * slot = &this->text_[input];
+        if (slot->reader != NULL) {
+            loads.push_back([slot]() {
+                slot->reader->readFromFile(slot->fileName.c_str());
+            });
+        }
+    }
+    dout << " Loading " << loads.size() << " inputs" << std::endl;
+    ThreadPool::shared().parallelFor(loads.size(), [&loads](size_t i) {
+        loads[i]();
+    });
+}
@@ -0,0 +1,98 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_INPUTLOADER_HPP_
+#define DEPLOID_SRC_INPUTLOADER_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "txtReader.hpp"
+#include "vcfReader.hpp"
+
+using std::string;
+using std::vector;
+
+/*! \brief Loads all inputs of a dEploid run at the same time
+ *
+ *  The inputs are named first, then load() reads all of them as tasks on the
+ *  shared thread pool and returns once every one is ready. If loads fail, the
+ *  exception of the first failing input, in the order vcf, ref, alt, PLAF,
+ *  panel, exclude, is rethrown with its own type, e.g. InvalidInputFile or
+ *  InvalidSampleInVcf.
+ *
+ *  Text inputs can be read into a reader of the caller, e.g. a Panel, and are
+ *  otherwise read into a TxtReader, or an ExcludeMarker for the exclude list,
+ *  that the loader owns.
+ */
+class InputLoader {
+#ifdef UNITTEST
+    friend class TestInputLoader;
+#endif
+ public:
+    InputLoader() {}
+    ~InputLoader() {}
+
+    void setVcf(const string & fileName, const string & sampleName,
+                const bool extractPlaf = false);
+    void setRef(const string & fileName, TxtReader * reader = NULL);
+    void setAlt(const string & fileName, TxtReader * reader = NULL);
+    void setPlaf(const string & fileName, TxtReader * reader = NULL);
+    void setPanel(const string & fileName, TxtReader * reader = NULL);
+    void setExclude(const string & fileName, ExcludeMarker * reader = NULL);
+
+    void load();
+
+    // The readers, NULL for inputs that were not set
+    VcfReader * vcf() const { return this->vcf_.get(); }
+    TxtReader * ref() const { return this->text_[REF].reader; }
+    TxtReader * alt() const { return this->text_[ALT].reader; }
+    TxtReader * plaf() const { return this->text_[PLAF].reader; }
+    TxtReader * panel() const { return this->text_[PANEL].reader; }
+    ExcludeMarker * exclude() const {
+        return static_cast<ExcludeMarker *>(this->text_[EXCLUDE].reader); }
+
+ private:
+    InputLoader(const InputLoader &);
+    InputLoader & operator=(const InputLoader &);
+
+    enum TextInput { REF, ALT, PLAF, PANEL, EXCLUDE, N_TEXT_INPUTS };
+    struct TextSlot {
+        string fileName;
+        TxtReader * reader;
+        std::unique_ptr <TxtReader> owned;
+        TextSlot() : reader(NULL) {}
+    };
+    void setText(const TextInput input, const string & fileName,
+                 TxtReader * reader);
+
+    string vcfFileName_;
+    string sampleName_;
+    bool extractPlaf_;
+    std::unique_ptr <VcfReader> vcf_;
+    TextSlot text_[N_TEXT_INPUTS];
+};
+
+#endif  // DEPLOID_SRC_INPUTLOADER_HPP_
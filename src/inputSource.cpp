@@ -0,0 +1,241 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>     // open
+#include <unistd.h>    // read, close
+#include <algorithm>   // min
+#include <string>
+#include "exceptions.hpp"
+#include "inputSource.hpp"
+
+using std::min;
+
+const size_t SourceBuf::headSize;
+const size_t SourceBuf::bufferSize;
+
+
+InputSource InputSource::path(const string & fileName) {
+    return InputSource(PATH, fileName);
+}
+
+
+InputSource InputSource::fd(int fd, const string & name) {
+    InputSource source(FD, name.empty() ? "fd " + std::to_string(fd) : name);
+    source.fd_ = fd;
+    return source;
+}
+
+
+InputSource InputSource::standardInput() {
+    return InputSource::fd(STDIN_FILENO, "stdin");
+}
+
+
+InputSource InputSource::memory(const char * data, size_t size,
+                                const string & name) {
+    InputSource source(MEMORY, name);
+    source.data_ = data;
+    source.size_ = size;
+    return source;
+}
+
+
+InputSource InputSource::fromName(const string & name) {
+    return (name == "-") ? InputSource::standardInput() :
+                           InputSource::path(name);
+}
+
+
+SourceBuf::SourceBuf() : isOpen_(false), isCompressed_(false),
+                         ownsFd_(false), rawEof_(true), inflateDone_(false),
+                         fd_(-1), memory_(NULL), memorySize_(0),
+                         rawBegin_(NULL), rawEnd_(NULL),
+                         zsInitialized_(false) {
+    this->setg(NULL, NULL, NULL);
+}
+
+
+void SourceBuf::open(const InputSource & source) {
+    this->close();
+    this->name_ = source.name();
+    if (source.kind() == InputSource::MEMORY) {
+        this->memory_ = source.data();
+        this->memorySize_ = source.size();
+        // All of the input is there already
+        this->rawBegin_ = this->memory_;
+        this->rawEnd_ = this->memory_ + this->memorySize_;
+        this->rawEof_ = true;
+    } else {
+        if (source.kind() == InputSource::PATH) {
+            this->fd_ = ::open(source.name().c_str(), O_RDONLY);
+            this->ownsFd_ = true;
+        } else {
+            this->fd_ = source.fd();
+        }
+        if (this->fd_ < 0) {
+            throw InvalidInputFile(source.name());
+        }
+        this->rawBuffer_.resize(bufferSize);
+        this->rawBegin_ = this->rawBuffer_.data();
+        this->rawEnd_ = this->rawBegin_;
+        this->rawEof_ = false;
+        // A pipe can return fewer bytes than asked for
+        while (static_cast<size_t>(this->rawEnd_ - this->rawBegin_) <
+                   headSize && !this->rawEof_) {
+            ssize_t n = ::read(this->fd_, const_cast<char *>(this->rawEnd_),
+                               bufferSize - (this->rawEnd_ - this->rawBegin_));
+            if (n > 0) {
+                this->rawEnd_ += n;
+            } else if (n == 0) {
+                this->rawEof_ = true;
+            } else if (errno != EINTR) {
+                throw InvalidInputFile(source.name());
+            }
+        }
+    }
+    this->isOpen_ = true;
+
+    size_t nHead;
+    const unsigned char * magic = reinterpret_cast<const unsigned char *>(
+                                      this->head(&nHead));
+    this->isCompressed_ = nHead >= 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    if (this->isCompressed_) {
+        this->outBuffer_.resize(bufferSize);
+        this->zs_.zalloc = Z_NULL;
+        this->zs_.zfree = Z_NULL;
+        this->zs_.opaque = Z_NULL;
+        this->zs_.next_in = Z_NULL;
+        this->zs_.avail_in = 0;
+        // 32 has zlib read the gzip header
+        if (inflateInit2(&this->zs_, 15 + 32) != Z_OK) {
+            throw InvalidInputFile(source.name());
+        }
+        this->zsInitialized_ = true;
+        this->inflateDone_ = false;
+    }
+}
+
+
+void SourceBuf::close() {
+    if (this->zsInitialized_) {
+        inflateEnd(&this->zs_);
+        this->zsInitialized_ = false;
+    }
+    if (this->ownsFd_ && this->fd_ >= 0) {
+        ::close(this->fd_);
+    }
+    this->ownsFd_ = false;
+    this->fd_ = -1;
+    this->memory_ = NULL;
+    this->memorySize_ = 0;
+    this->rawBegin_ = NULL;
+    this->rawEnd_ = NULL;
+    this->rawEof_ = true;
+    this->isOpen_ = false;
+    this->isCompressed_ = false;
+    this->setg(NULL, NULL, NULL);
+}
+
+
+const char * SourceBuf::head(size_t * nBytes) const {
+    *nBytes = min(headSize, static_cast<size_t>(this->rawEnd_ -
+                                                this->rawBegin_));
+    return this->rawBegin_;
+}
+
+
+bool SourceBuf::refill() {
+    while (!this->rawEof_) {
+        ssize_t n = ::read(this->fd_, this->rawBuffer_.data(), bufferSize);
+        if (n > 0) {
+            this->rawBegin_ = this->rawBuffer_.data();
+            this->rawEnd_ = this->rawBegin_ + n;
+            return true;
+        }
+        if (n == 0) {
+            this->rawEof_ = true;
+        } else if (errno != EINTR) {
+            throw InvalidInputFile(this->name_);
+        }
+    }
+    return false;
+}
+
+
+int SourceBuf::underflow() {
+    if (this->gptr() < this->egptr()) {
+        return traits_type::to_int_type(*this->gptr());
+    }
+    if (!this->isOpen_) {
+        return traits_type::eof();
+    }
+    if (this->isCompressed_) {
+        return this->underflowCompressed();
+    }
+    // Plain input is read where it is, in the raw buffer or the memory
+    if (this->rawBegin_ == this->rawEnd_ && !this->refill()) {
+        return traits_type::eof();
+    }
+    char * begin = const_cast<char *>(this->rawBegin_);
+    this->setg(begin, begin, const_cast<char *>(this->rawEnd_));
+    this->rawBegin_ = this->rawEnd_;
+    return traits_type::to_int_type(*this->gptr());
+}
+
+
+int SourceBuf::underflowCompressed() {
+    char * out = this->outBuffer_.data();
+    this->zs_.next_out = reinterpret_cast<Bytef *>(out);
+    this->zs_.avail_out = bufferSize;
+    while (!this->inflateDone_ && this->zs_.avail_out == bufferSize) {
+        // Members are only reset with input left, so a member is open here
+        if (this->rawBegin_ == this->rawEnd_ && !this->refill()) {
+            throw InvalidInputFile(this->name_);
+        }
+        this->zs_.next_in = reinterpret_cast<Bytef *>(
+                                const_cast<char *>(this->rawBegin_));
+        this->zs_.avail_in = this->rawEnd_ - this->rawBegin_;
+        int ret = inflate(&this->zs_, Z_NO_FLUSH);
+        this->rawBegin_ = this->rawEnd_ - this->zs_.avail_in;
+        if (ret == Z_STREAM_END) {
+            // Another member may follow, e.g. the next BGZF block
+            if (this->rawBegin_ == this->rawEnd_ && !this->refill()) {
+                this->inflateDone_ = true;
+            } else {
+                inflateReset(&this->zs_);
+            }
+        } else if (ret != Z_OK) {
+            // Corrupted input is an error, not a shorter file
+            throw InvalidInputFile(this->name_);
+        }
+    }
+    size_t nOut = bufferSize - this->zs_.avail_out;
+    if (nOut == 0) {
+        return traits_type::eof();
+    }
+    this->setg(out, out, out + nOut);
+    return traits_type::to_int_type(*this->gptr());
+}
@@ -0,0 +1,155 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_INPUTSOURCE_HPP_
+#define DEPLOID_SRC_INPUTSOURCE_HPP_
+
+#include <zlib.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/*! \brief Where an input is read from: a file, a file descriptor, e.g. a
+ *  pipe from bcftools or standard input, or a buffer in memory
+ *
+ *  A source only describes the input, InputStream opens it. File
+ *  descriptors and buffers are borrowed, they are not closed or freed, and
+ *  must stay valid while a reader reads them.
+ */
+class InputSource {
+ public:
+    enum Kind { PATH, FD, MEMORY };
+
+    static InputSource path(const string & fileName);
+    /*! Name is what errors show, "fd <fd>" by default */
+    static InputSource fd(int fd, const string & name = "");
+    static InputSource standardInput();
+    static InputSource memory(const char * data, size_t size,
+                              const string & name = "memory");
+    /*! "-" is standard input, anything else a path */
+    static InputSource fromName(const string & name);
+
+    Kind kind() const { return this->kind_; }
+    bool isPath() const { return this->kind_ == PATH; }
+    const string & name() const { return this->name_; }
+    int fd() const { return this->fd_; }
+    const char * data() const { return this->data_; }
+    size_t size() const { return this->size_; }
+
+ private:
+    InputSource(Kind kind, const string & name)
+        : kind_(kind), name_(name), fd_(-1), data_(NULL), size_(0) {}
+
+    Kind kind_;
+    string name_;
+    int fd_;
+    const char * data_;
+    size_t size_;
+};
+
+
+/*! \brief Stream buffer over an InputSource, inflating gzip input
+ *
+ *  The first bytes are read once into the buffer of the raw input, where
+ *  they tell if the input is gzip compressed and can be looked at, e.g. for
+ *  the magic of a binary panel. Nothing is read twice, so pipes work.
+ *  Concatenated gzip members, as in BGZF, are read one after the other.
+ */
+class SourceBuf : public std::streambuf {
+ public:
+    static const size_t headSize = 8;
+
+    SourceBuf();
+    ~SourceBuf() { this->close(); }
+
+    /*! Throws InvalidInputFile if a path can not be opened, or if reading
+     *  the input fails, including gzip input that is corrupted or cut short */
+    void open(const InputSource & source);
+    void close();
+    bool isOpen() const { return this->isOpen_; }
+    bool isCompressed() const { return this->isCompressed_; }
+    /*! Up to headSize raw bytes at the start of the input, fewer if the
+     *  input is shorter. Only valid before anything is read. */
+    const char * head(size_t * nBytes) const;
+
+ protected:
+    virtual int underflow();
+
+ private:
+    static const size_t bufferSize = 1 << 16;
+
+    bool isOpen_;
+    bool isCompressed_;
+    bool ownsFd_;
+    bool rawEof_;
+    bool inflateDone_;
+    int fd_;
+    string name_;
+    const char * memory_;
+    size_t memorySize_;
+    // Unread raw input, in rawBuffer_ or in the memory of the source
+    const char * rawBegin_;
+    const char * rawEnd_;
+    vector <char> rawBuffer_;
+    vector <char> outBuffer_;
+    z_stream zs_;
+    bool zsInitialized_;
+
+    bool refill();
+    int underflowCompressed();
+};
+
+
+/*! \brief Input stream over an InputSource */
+class InputStream : public std::istream {
+ public:
+    InputStream() : std::istream(NULL) {
+        this->init(&this->buf_);
+        // A read error of the buffer reaches the reader, rather than
+        // ending the input as if the file was shorter
+        this->exceptions(std::ios::badbit);
+    }
+
+    void open(const InputSource & source) {
+        this->buf_.open(source);
+        this->clear();
+    }
+    void close() {
+        this->buf_.close();
+        this->clear();
+    }
+    bool isOpen() const { return this->buf_.isOpen(); }
+    bool isCompressed() const { return this->buf_.isCompressed(); }
+    const char * head(size_t * nBytes) const {
+        return this->buf_.head(nBytes); }
+
+ private:
+    SourceBuf buf_;
+};
+
+#endif  // DEPLOID_SRC_INPUTSOURCE_HPP_
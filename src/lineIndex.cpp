@@ -0,0 +1,427 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <fcntl.h>      // open
+#include <sys/stat.h>   // stat
+#include <unistd.h>     // pread, close
+#include <zlib.h>       // crc32
+#include <algorithm>    // min
+#include <cstdio>       // FILE, rename
+#include <cstdlib>      // free
+#include <cstring>      // memcpy, strcspn
+#include <fstream>
+#include <iostream>
+#include <iterator>     // istreambuf_iterator
+#include "exceptions.hpp"
+#include "global.hpp"
+#include "inputSource.hpp"
+#include "lineIndex.hpp"
+
+using std::endl;
+
+const char LineIndex::magic_[8] = {'D', 'E', 'P', 'L', 'O', 'I', 'D', 'L'};
+const uint64_t LineIndex::stride_;
+
+
+namespace {
+
+// Bytes of the start and the end of a file that are checksummed
+const uint64_t fingerprintBytes = 1 << 16;
+
+/*! Fixed size start of a sidecar, followed by the sampled offsets, the
+ *  chromosome runs and a crc32 of all of it */
+struct SidecarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nHeaderLines;
+    uint64_t stride;
+    uint64_t fileSize;
+    int64_t modified;
+    uint32_t headCrc;
+    uint32_t tailCrc;
+    uint64_t dataStart;
+    uint64_t dataEnd;
+    uint64_t nLines;
+    uint64_t nSamples;
+    uint64_t nRuns;
+};
+
+
+template <class T>
+void append(string * bytes, const T & value) {
+    bytes->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+
+template <class T>
+bool take(const string & bytes, size_t * cursor, T * value) {
+    if (*cursor + sizeof(T) > bytes.size()) {
+        return false;
+    }
+    memcpy(value, bytes.data() + *cursor, sizeof(T));
+    *cursor += sizeof(T);
+    return true;
+}
+
+
+uint32_t crcOf(const char * data, size_t size) {
+    return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0),
+        reinterpret_cast<const Bytef *>(data), size));
+}
+
+}  // namespace
+
+
+bool FileFingerprint::of(const string & fileName) {
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        return false;
+    }
+    this->fileSize = static_cast<uint64_t>(fileStat.st_size);
+    this->modified = static_cast<int64_t>(fileStat.st_mtime);
+    uint64_t nBytes = std::min(fingerprintBytes, this->fileSize);
+    string bytes;
+    try {
+        LineIndex::readRange(fileName, 0, nBytes, &bytes);
+        this->isGzip = nBytes >= 2 &&
+                       static_cast<unsigned char>(bytes[0]) == 0x1f &&
+                       static_cast<unsigned char>(bytes[1]) == 0x8b;
+        this->headCrc = crcOf(bytes.data(), bytes.size());
+        LineIndex::readRange(fileName, this->fileSize - nBytes,
+                             this->fileSize, &bytes);
+        this->tailCrc = crcOf(bytes.data(), bytes.size());
+    } catch (const InvalidInputFile &) {
+        return false;
+    }
+    return true;
+}
+
+
+void LineIndex::readRange(const string & fileName, uint64_t begin,
+                          uint64_t end, string * bytes) {
+    bytes->resize(end - begin);
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw InvalidInputFile(fileName);
+    }
+    size_t nRead = 0;
+    while (nRead < bytes->size()) {
+        ssize_t n = pread(fd, &(*bytes)[nRead], bytes->size() - nRead,
+                          begin + nRead);
+        if (n <= 0) {
+            break;
+        }
+        nRead += n;
+    }
+    close(fd);
+    if (nRead < bytes->size()) {
+        throw InvalidInputFile(fileName);
+    }
+}
+
+
+bool LineIndex::loadOrBuild(const string & fileName,
+                            const size_t nHeaderLines) {
+    // Only plain files are read at the offsets of the index
+    FileFingerprint fingerprint;
+    if (!fingerprint.of(fileName) || fingerprint.isGzip) {
+        return false;
+    }
+    if (this->read(fileName, nHeaderLines)) {
+        return true;
+    }
+    this->build(fileName, nHeaderLines);
+    if (!this->write(fileName)) {
+        dout << " Line index of " << fileName << " not written" << endl;
+    }
+    return true;
+}
+
+
+void LineIndex::build(const string & fileName, const size_t nHeaderLines) {
+    FileFingerprint fingerprint;
+    if (!fingerprint.of(fileName)) {
+        throw InvalidInputFile(fileName);
+    }
+    InputStream in;
+    in.open(InputSource::path(fileName));
+    this->startScan(nHeaderLines);
+    vector <char> buffer(1 << 16);
+    while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+        this->scan(buffer.data(), in.gcount());
+    }
+    this->finishScan(fingerprint);
+    dout << " Indexed " << this->nLines_ << " lines of " << fileName << endl;
+}
+
+
+void LineIndex::startScan(const size_t nHeaderLines) {
+    this->nHeaderLines_ = nHeaderLines;
+    this->dataStart_ = 0;
+    this->dataEnd_ = 0;
+    this->nLines_ = 0;
+    this->samples_.clear();
+    this->chromNames_.clear();
+    this->chromRuns_.clear();
+    this->scan_.offset = 0;
+    this->scan_.lineStart = 0;
+    this->scan_.lineI = 0;
+    this->scan_.inData = false;
+    this->scan_.ended = false;
+    this->scan_.atLineStart = true;
+    this->scan_.isHeaderLine = false;
+    this->scan_.inChrom = false;
+    this->scan_.chrom.clear();
+}
+
+
+void LineIndex::scan(const char * data, size_t size) {
+    ScanState & state = this->scan_;
+    const char * p = data;
+    const char * end = data + size;
+    while (p < end && !state.ended) {
+        if (state.atLineStart) {
+            state.atLineStart = false;
+            state.lineStart = state.offset + (p - data);
+            if (*p == '\n') {
+                // The readers stop at the first empty line
+                state.ended = true;
+                this->dataEnd_ = state.lineStart;
+                break;
+            }
+            state.isHeaderLine = !state.inData &&
+                (state.lineI < this->nHeaderLines_ || *p == '#');
+            state.lineI++;
+            if (!state.isHeaderLine) {
+                if (!state.inData) {
+                    state.inData = true;
+                    this->dataStart_ = state.lineStart;
+                }
+                if (this->nLines_ % stride_ == 0) {
+                    this->samples_.push_back(state.lineStart);
+                }
+                state.inChrom = true;
+                state.chrom.clear();
+            }
+        }
+        if (state.inChrom) {
+            // The chromosome is the first field, it may end in the next piece
+            const char * fieldEnd = p;
+            while (fieldEnd < end && *fieldEnd != ' ' && *fieldEnd != ',' &&
+                   *fieldEnd != '\t' && *fieldEnd != '\n') {
+                fieldEnd++;
+            }
+            state.chrom.append(p, fieldEnd);
+            p = fieldEnd;
+            if (p == end) {
+                break;
+            }
+            this->endChrom();
+        }
+        const char * lineEnd = static_cast<const char *>(
+                                   memchr(p, '\n', end - p));
+        if (lineEnd == NULL) {
+            break;
+        }
+        p = lineEnd + 1;
+        state.atLineStart = true;
+        if (!state.isHeaderLine) {
+            this->chromRuns_.back().end = state.offset + (p - data);
+        }
+    }
+    state.offset += size;
+}
+
+
+void LineIndex::endChrom() {
+    ScanState & state = this->scan_;
+    state.inChrom = false;
+    if (this->chromNames_.empty() || state.chrom != this->chromNames_.back()) {
+        LineRange run = {this->nLines_, 0, state.lineStart, state.lineStart};
+        this->chromNames_.push_back(state.chrom);
+        this->chromRuns_.push_back(run);
+    }
+    this->chromRuns_.back().nLines++;
+    this->nLines_++;
+}
+
+
+void LineIndex::finishScan(const FileFingerprint & fingerprint) {
+    ScanState & state = this->scan_;
+    if (!state.ended) {
+        // A last line without a newline
+        if (state.inChrom) {
+            this->endChrom();
+        }
+        if (!state.atLineStart && !state.isHeaderLine) {
+            this->chromRuns_.back().end = state.offset;
+        }
+        this->dataEnd_ = state.offset;
+    }
+    if (!state.inData) {
+        this->dataStart_ = this->dataEnd_;
+    }
+    this->fingerprint_ = fingerprint;
+}
+
+
+bool LineIndex::write(const string & fileName) const {
+    SidecarHeader header;
+    memcpy(header.magic, LineIndex::magic_, 8);
+    header.version = LineIndex::version_;
+    header.nHeaderLines = this->nHeaderLines_;
+    header.stride = stride_;
+    header.fileSize = this->fingerprint_.fileSize;
+    header.modified = this->fingerprint_.modified;
+    header.headCrc = this->fingerprint_.headCrc;
+    header.tailCrc = this->fingerprint_.tailCrc;
+    header.dataStart = this->dataStart_;
+    header.dataEnd = this->dataEnd_;
+    header.nLines = this->nLines_;
+    header.nSamples = this->samples_.size();
+    header.nRuns = this->chromRuns_.size();
+
+    string bytes;
+    append(&bytes, header);
+    for (auto const &sample : this->samples_) {
+        append(&bytes, sample);
+    }
+    for (size_t i = 0; i < this->chromRuns_.size(); i++) {
+        append(&bytes, this->chromRuns_[i]);
+        append(&bytes, static_cast<uint32_t>(this->chromNames_[i].size()));
+        bytes += this->chromNames_[i];
+    }
+    append(&bytes, crcOf(bytes.data(), bytes.size()));
+
+    // Written aside and moved in place, a reader never sees half a sidecar
+    string sidecar = LineIndex::sidecarName(fileName);
+    string partial = sidecar + ".tmp";
+    std::ofstream out(partial.c_str(), std::ios::out | std::ios::binary |
+                                       std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    out.close();
+    if (out.fail() || std::rename(partial.c_str(), sidecar.c_str()) != 0) {
+        std::remove(partial.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool LineIndex::read(const string & fileName, const size_t nHeaderLines) {
+    std::ifstream in(LineIndex::sidecarName(fileName).c_str(),
+                     std::ios::in | std::ios::binary);
+    if (!in.good()) {
+        return false;
+    }
+    string bytes((std::istreambuf_iterator<char>(in)),
+                 std::istreambuf_iterator<char>());
+    uint32_t crc;
+    if (bytes.size() < sizeof(SidecarHeader) + sizeof(crc)) {
+        return false;
+    }
+    size_t body = bytes.size() - sizeof(crc);
+    memcpy(&crc, bytes.data() + body, sizeof(crc));
+    if (crc != crcOf(bytes.data(), body)) {
+        return false;
+    }
+    bytes.resize(body);
+
+    size_t cursor = 0;
+    SidecarHeader header;
+    take(bytes, &cursor, &header);
+    FileFingerprint fingerprint;
+    fingerprint.fileSize = header.fileSize;
+    fingerprint.modified = header.modified;
+    fingerprint.headCrc = header.headCrc;
+    fingerprint.tailCrc = header.tailCrc;
+    FileFingerprint now;
+    if (memcmp(header.magic, LineIndex::magic_, 8) != 0 ||
+            header.version != LineIndex::version_ ||
+            header.nHeaderLines != nHeaderLines ||
+            header.stride != stride_ ||
+            !now.of(fileName) || !(now == fingerprint)) {
+        return false;
+    }
+
+    vector <uint64_t> samples(header.nSamples);
+    for (auto &sample : samples) {
+        if (!take(bytes, &cursor, &sample)) {
+            return false;
+        }
+    }
+    vector <string> chromNames(header.nRuns);
+    vector <LineRange> chromRuns(header.nRuns);
+    for (size_t i = 0; i < header.nRuns; i++) {
+        uint32_t nameLength;
+        if (!take(bytes, &cursor, &chromRuns[i]) ||
+                !take(bytes, &cursor, &nameLength) ||
+                cursor + nameLength > bytes.size()) {
+            return false;
+        }
+        chromNames[i].assign(bytes.data() + cursor, nameLength);
+        cursor += nameLength;
+    }
+
+    this->fingerprint_ = now;
+    this->nHeaderLines_ = header.nHeaderLines;
+    this->dataStart_ = header.dataStart;
+    this->dataEnd_ = header.dataEnd;
+    this->nLines_ = header.nLines;
+    this->samples_.swap(samples);
+    this->chromNames_.swap(chromNames);
+    this->chromRuns_.swap(chromRuns);
+    return true;
+}
+
+
+vector <LineRange> LineIndex::chunks(const LineRange & range,
+                                     size_t nChunks) const {
+    vector <LineRange> chunks;
+    if (range.nLines == 0) {
+        return chunks;
+    }
+    uint64_t last = range.firstLine + range.nLines;
+    LineRange chunk = range;
+    for (size_t i = 1; i < nChunks; i++) {
+        // The cut is the sampled line nearest to an even split
+        uint64_t target = range.firstLine + range.nLines * i / nChunks;
+        uint64_t sampleI = (target + stride_ / 2) / stride_;
+        uint64_t cut = sampleI * stride_;
+        if (sampleI >= this->samples_.size() || cut <= chunk.firstLine ||
+                cut >= last) {
+            continue;
+        }
+        chunk.nLines = cut - chunk.firstLine;
+        chunk.end = this->samples_[sampleI];
+        chunks.push_back(chunk);
+        chunk.firstLine = cut;
+        chunk.begin = this->samples_[sampleI];
+    }
+    chunk.nLines = last - chunk.firstLine;
+    chunk.end = range.end;
+    chunks.push_back(chunk);
+    return chunks;
+}
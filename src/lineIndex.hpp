@@ -0,0 +1,185 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_LINEINDEX_HPP_
+#define DEPLOID_SRC_LINEINDEX_HPP_
+
+#include <stdint.h>  // uint64_t
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/*! Lines [firstLine, firstLine + nLines) of the data, at bytes [begin, end)
+ *  of the file, e.g. a run of lines of one chromosome */
+struct LineRange {
+    uint64_t firstLine;
+    uint64_t nLines;
+    uint64_t begin;
+    uint64_t end;
+};
+
+
+/*! \brief What a sidecar index was built from: the size, the modification
+ *  time and checksums of the first and last bytes of a file. A sidecar is
+ *  only used while they match the file. */
+struct FileFingerprint {
+    uint64_t fileSize;
+    int64_t modified;
+    uint32_t headCrc;
+    uint32_t tailCrc;
+    bool isGzip;
+
+    FileFingerprint() : fileSize(0), modified(0), headCrc(0), tailCrc(0),
+                        isGzip(false) {}
+    /*! False if the file can not be read */
+    bool of(const string & fileName);
+    bool operator==(const FileFingerprint & other) const {
+        return this->fileSize == other.fileSize &&
+               this->modified == other.modified &&
+               this->headCrc == other.headCrc &&
+               this->tailCrc == other.tailCrc; }
+};
+
+
+/*! \brief Byte offsets of the data lines of a text file, kept in a sidecar
+ *  file next to it
+ *
+ *  The offset of every stride-th data line is sampled, and for every run of
+ *  lines of one chromosome the offsets of its first and last line. With
+ *  them a reader can seek straight to a chromosome, and cut the data into
+ *  chunks of about the same number of lines without a scan.
+ *
+ *  Header lines are the first nHeaderLines lines, and all lines that start
+ *  with '#', as for RowEstimate. The data ends at the first empty line, as
+ *  in the readers. The sidecar is fileName + ".lidx".
+ *
+ *  The offsets are in the data as it is read, so for a gzipped file they
+ *  are offsets in the inflated data, and a GzIndex finds them in the file.
+ */
+class LineIndex {
+#ifdef UNITTEST
+    friend class TestLineIndex;
+    friend class TestGzIndex;
+#endif
+ public:
+    static const char magic_[8];
+    static const uint32_t version_ = 2;
+    static const uint64_t stride_ = 1024;
+
+    LineIndex() : nHeaderLines_(0), dataStart_(0), dataEnd_(0), nLines_(0),
+                  scan_() {}
+
+    static string sidecarName(const string & fileName) {
+        return fileName + ".lidx"; }
+
+    /*! Index of a plain text file, read from its sidecar when it is up to
+     *  date, else built by a scan of the file and written to the sidecar.
+     *  False for gzipped files, which GzIndex::loadOrBuild() indexes. The
+     *  sidecar is optional, a sidecar that can not be written is left out.
+     */
+    bool loadOrBuild(const string & fileName, const size_t nHeaderLines = 0);
+    /*! Scan the file, plain or gzipped, throws InvalidInputFile if it can
+     *  not be read */
+    void build(const string & fileName, const size_t nHeaderLines = 0);
+    /*! Build the index from the data handed to scan() in pieces, e.g. by a
+     *  GzIndex while it inflates the file */
+    void startScan(const size_t nHeaderLines);
+    void scan(const char * data, size_t size);
+    void finishScan(const FileFingerprint & fingerprint);
+    /*! False if the sidecar is missing, corrupted or out of date */
+    bool read(const string & fileName, const size_t nHeaderLines = 0);
+    bool write(const string & fileName) const;
+
+    uint64_t nLines() const { return this->nLines_; }
+    uint64_t dataStart() const { return this->dataStart_; }
+    uint64_t dataEnd() const { return this->dataEnd_; }
+    LineRange all() const {
+        LineRange range = {0, this->nLines_, this->dataStart_, this->dataEnd_};
+        return range; }
+    /* Runs of lines of one chromosome in file order, a chromosome that
+     * comes back later has another run */
+    const vector <string> & chromNames() const { return this->chromNames_; }
+    const vector <LineRange> & chromRuns() const { return this->chromRuns_; }
+
+    /*! Runs of the chromosomes for which keep(name) is true, with runs that
+     *  follow each other merged into one range */
+    template <class Keep>
+    vector <LineRange> select(Keep keep) const {
+        vector <LineRange> ranges;
+        for (size_t i = 0; i < this->chromRuns_.size(); i++) {
+            const LineRange & run = this->chromRuns_[i];
+            if (!keep(this->chromNames_[i])) {
+                continue;
+            }
+            if (!ranges.empty() && ranges.back().end == run.begin) {
+                ranges.back().nLines += run.nLines;
+                ranges.back().end = run.end;
+            } else {
+                ranges.push_back(run);
+            }
+        }
+        return ranges;
+    }
+
+    /*! The range split at sampled lines into at most nChunks chunks of
+     *  about the same number of lines */
+    vector <LineRange> chunks(const LineRange & range, size_t nChunks) const;
+
+    /*! Bytes [begin, end) of a plain file */
+    static void readRange(const string & fileName, uint64_t begin,
+                          uint64_t end, string * bytes);
+
+ private:
+    // What the index was built from
+    FileFingerprint fingerprint_;
+    uint32_t nHeaderLines_;
+
+    uint64_t dataStart_;
+    uint64_t dataEnd_;
+    uint64_t nLines_;
+    // Offset of line i * stride_
+    vector <uint64_t> samples_;
+    vector <string> chromNames_;
+    vector <LineRange> chromRuns_;
+
+    // Where scan() is
+    struct ScanState {
+        uint64_t offset;
+        uint64_t lineStart;
+        uint64_t lineI;
+        bool inData;
+        bool ended;
+        bool atLineStart;
+        bool isHeaderLine;
+        bool inChrom;
+        string chrom;
+    };
+    ScanState scan_;
+    void endChrom();
+};
+
+#endif  // DEPLOID_SRC_LINEINDEX_HPP_
@@ -0,0 +1,176 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>  // stat
+#include <zlib.h>
+#include <algorithm>  // min, max
+#include <vector>
+#include "rowEstimate.hpp"
+
+using std::vector;
+
+namespace {
+// At least this much of the data rows is read to find their average length
+const size_t sampleBytes = 64 * 1024;
+// A longer header is not read to the end, the estimate is then left empty
+const size_t maxHeaderBytes = 64 * 1024 * 1024;
+// Deflate hardly ever makes text rows more than this many times smaller
+const uint64_t maxInflation = 32;
+
+bool isBgzfHeader(const unsigned char * header, const size_t nBytes) {
+    return nBytes >= 18 && header[0] == 0x1f && header[1] == 0x8b &&
+           (header[3] & 4) != 0 && header[12] == 'B' && header[13] == 'C';
+}
+
+uint32_t littleEndian32(const unsigned char * bytes) {
+    return static_cast<uint32_t>(bytes[0]) |
+           static_cast<uint32_t>(bytes[1]) << 8 |
+           static_cast<uint32_t>(bytes[2]) << 16 |
+           static_cast<uint32_t>(bytes[3]) << 24;
+}
+}  // namespace
+
+
+uint64_t RowEstimate::dataSize(const string & fileName) {
+    FILE * f = fopen(fileName.c_str(), "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    fseeko(f, 0, SEEK_END);
+    uint64_t fileBytes = ftello(f);
+    fseeko(f, 0, SEEK_SET);
+
+    // Fixed gzip header, and the extra field that BGZF puts its block size in
+    unsigned char header[18];
+    size_t nRead = fread(header, 1, sizeof(header), f);
+    bool isGzip = nRead >= 10 && header[0] == 0x1f && header[1] == 0x8b;
+    uint64_t dataBytes = fileBytes;
+    if (isGzip && isBgzfHeader(header, nRead)) {
+        // BGZF, the sizes in the headers and trailers of all blocks add up
+        // to the size of the data
+        uint64_t blockStart = 0;
+        dataBytes = 0;
+        while (blockStart < fileBytes) {
+            unsigned char isize[4];
+            if (fseeko(f, blockStart, SEEK_SET) != 0 ||
+                    fread(header, 1, sizeof(header), f) != sizeof(header) ||
+                    !isBgzfHeader(header, sizeof(header))) {
+                break;
+            }
+            uint64_t blockBytes = (header[16] | header[17] << 8) + 1;
+            if (fseeko(f, blockStart + blockBytes - 4, SEEK_SET) != 0 ||
+                    fread(isize, 1, 4, f) != 4) {
+                break;
+            }
+            dataBytes += littleEndian32(isize);
+            blockStart += blockBytes;
+        }
+    } else if (isGzip) {
+        // The trailer holds the size of the last member modulo 2^32. A size
+        // below the file size has wrapped, or is only that of the last of
+        // several members, and the file size is all that is known then.
+        unsigned char isize[4];
+        if (fseeko(f, -4, SEEK_END) == 0 && fread(isize, 1, 4, f) == 4) {
+            dataBytes = std::max(static_cast<uint64_t>(littleEndian32(isize)),
+                                 fileBytes);
+        }
+    }
+    fclose(f);
+    return dataBytes;
+}
+
+
+RowEstimate RowEstimate::ofFile(const string & fileName,
+                                const size_t nHeaderLines) {
+    RowEstimate estimate;
+    // gzread reads plain files as they are
+    gzFile in = gzopen(fileName.c_str(), "rb");
+    if (in == NULL) {
+        return estimate;
+    }
+
+    vector <char> buffer(sampleBytes);
+    uint64_t headerBytes = 0;
+    uint64_t rowBytes = 0;
+    uint64_t lineBytes = 0;
+    uint64_t minRowBytes = 0;
+    size_t nLines = 0;
+    size_t nRows = 0;
+    bool atLineStart = true;
+    bool inHeader = false;
+    bool atEnd = false;
+    while (rowBytes < sampleBytes && headerBytes < maxHeaderBytes) {
+        int nRead = gzread(in, buffer.data(), buffer.size());
+        if (nRead <= 0) {
+            atEnd = (nRead == 0);
+            break;
+        }
+        for (int i = 0; i < nRead; i++) {
+            char c = buffer[i];
+            if (atLineStart) {
+                inHeader = nLines < nHeaderLines || c == '#';
+                atLineStart = false;
+            }
+            if (inHeader) {
+                headerBytes++;
+            } else {
+                rowBytes++;
+            }
+            lineBytes++;
+            if (c == '\n') {
+                if (!inHeader && (nRows == 0 || lineBytes < minRowBytes)) {
+                    minRowBytes = lineBytes;
+                }
+                lineBytes = 0;
+                nRows += inHeader ? 0 : 1;
+                nLines++;
+                atLineStart = true;
+            }
+        }
+    }
+    bool isPlain = gzdirect(in) == 1;
+    gzclose(in);
+
+    if (atEnd) {
+        // The whole file was read, a last row may not end with a newline
+        estimate.nRows = nRows + ((!atLineStart && !inHeader) ? 1 : 0);
+        estimate.exact = true;
+    } else if (nRows > 0) {
+        uint64_t dataBytes = dataSize(fileName);
+        uint64_t bodyBytes = (dataBytes > headerBytes) ?
+                             dataBytes - headerBytes : 0;
+        estimate.nRows = bodyBytes * nRows / rowBytes;
+        // Whatever a gzip trailer says, there are not many more rows than
+        // the file size over the shortest row
+        struct stat fileStat;
+        if (stat(fileName.c_str(), &fileStat) == 0) {
+            estimate.maxRows = static_cast<uint64_t>(fileStat.st_size) *
+                               (isPlain ? 1 : maxInflation) / minRowBytes;
+            estimate.nRows = std::min(estimate.nRows, estimate.maxRows);
+        }
+    }
+    return estimate;
+}
@@ -0,0 +1,72 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_ROWESTIMATE_HPP_
+#define DEPLOID_SRC_ROWESTIMATE_HPP_
+
+#include <stdint.h>  // uint64_t, SIZE_MAX
+#include <string>
+
+using std::string;
+
+/*! \brief Number of data rows of a plain or gzipped text file, for reserving
+ *  the columns before the file is read
+ *
+ *  The size of the data is the file size, or for a gzipped file the size in
+ *  its gzip trailer, or for a BGZF file the sum of the sizes in the trailers
+ *  of its blocks. The first lines of the file are read to find
+ *  the average length of a data row, and the number of rows is the size of
+ *  the data without the header over that length. A file that is read to the
+ *  end while sampling gives the exact number of rows.
+ */
+struct RowEstimate {
+    RowEstimate() : nRows(0), exact(false), maxRows(SIZE_MAX) {}
+
+    size_t nRows;
+    bool exact;
+    /* Bound of an estimate, the file size over the shortest sampled row,
+     * times 32 for a gzipped file */
+    size_t maxRows;
+
+    /* Header lines are the first nHeaderLines lines, and all lines that
+     * start with '#'. A file that can not be read gives no rows. */
+    static RowEstimate ofFile(const string & fileName,
+                              const size_t nHeaderLines = 0);
+    /* Capacity to reserve, an estimate gets a little room to grow */
+    size_t reserveSize() const {
+        if (this->exact) {
+            return this->nRows;
+        }
+        size_t roomy = this->nRows + this->nRows / 16;
+        return (roomy < this->maxRows) ? roomy : this->maxRows; }
+
+    /* Size of the data once decompressed, from the file size and the gzip
+     * trailer or the BGZF blocks. The trailer of a file of several members
+     * only has the size of the last one, it is not used when it is below
+     * the file size. */
+    static uint64_t dataSize(const string & fileName);
+};
+
+#endif  // DEPLOID_SRC_ROWESTIMATE_HPP_
@@ -0,0 +1,181 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>  // find
+#include <iostream>
+#include "exceptions.hpp"
+#include "siteAligner.hpp"
+
+using std::endl;
+
+
+void SiteAligner::addInput(VariantIndex * input, const string & name,
+                           AlignRole role) {
+    assert(input->doneGetIndexOfChromStarts() == true);
+    this->inputs_.push_back(input);
+    this->names_.push_back(name);
+    this->roles_.push_back(role);
+}
+
+
+void SiteAligner::align() {
+    this->nSites_ = 0;
+    this->chrom_.clear();
+    this->chromId_.clear();
+    this->position_.clear();
+    this->keptRows_.assign(this->inputs_.size(), vector <size_t>());
+
+    // Chromosomes of all inputs in order of first appearance, sites on
+    // chromosomes that only an exclude list has can never be kept
+    vector <ChromId> allChrom;
+    for (size_t i = 0; i < this->inputs_.size(); i++) {
+        if (this->roles_[i] == ALIGN_EXCLUDE) {
+            continue;
+        }
+        for (auto const &chromId : this->inputs_[i]->chromId_) {
+            if (std::find(allChrom.begin(), allChrom.end(), chromId) ==
+                    allChrom.end()) {
+                allChrom.push_back(chromId);
+            }
+        }
+    }
+
+    for (auto const &chromId : allChrom) {
+        this->alignChrom(chromId);
+    }
+    dout << " Aligned " << this->nSites_ << " sites over "
+         << this->inputs_.size() << " inputs" << endl;
+}
+
+
+void SiteAligner::alignChrom(const ChromId chromId) {
+    // Where each input is in its positions of this chromosome
+    struct Cursor {
+        Span <int> positions;
+        size_t chromI;
+        size_t posI;
+        bool hasSite;
+        bool done() const { return this->posI >= this->positions.size(); }
+    };
+    size_t nInputs = this->inputs_.size();
+    vector <Cursor> cursors(nInputs);
+
+    for (size_t i = 0; i < nInputs; i++) {
+        const VariantIndex * input = this->inputs_[i];
+        cursors[i].chromI = input->findChrom(chromId);
+        cursors[i].posI = 0;
+        if (cursors[i].chromI < input->chrom_.size()) {
+            cursors[i].positions = input->position_[cursors[i].chromI];
+        }
+    }
+
+    vector <int> keptPositions;
+    while (true) {
+        // The next site is the smallest position under any cursor
+        bool hasNext = false;
+        int site = 0;
+        for (auto const &cursor : cursors) {
+            if (!cursor.done()) {
+                int pos = cursor.positions[cursor.posI];
+                if (!hasNext || pos < site) {
+                    site = pos;
+                    hasNext = true;
+                }
+            }
+        }
+        if (!hasNext) {
+            break;
+        }
+
+        bool excluded = false;
+        bool inSomeStrictInput = false;
+        bool inAllInputs = true;
+        for (size_t i = 0; i < nInputs; i++) {
+            Cursor & cursor = cursors[i];
+            cursor.hasSite = !cursor.done() &&
+                             cursor.positions[cursor.posI] == site;
+            if (this->roles_[i] == ALIGN_EXCLUDE) {
+                excluded = excluded || cursor.hasSite;
+            } else {
+                inAllInputs = inAllInputs && cursor.hasSite;
+            }
+            if (this->roles_[i] == ALIGN_STRICT) {
+                inSomeStrictInput = inSomeStrictInput || cursor.hasSite;
+            }
+        }
+
+        if (!excluded && inSomeStrictInput) {
+            for (size_t i = 0; i < nInputs; i++) {
+                if (this->roles_[i] == ALIGN_STRICT && !cursors[i].hasSite) {
+                    dout << " Site " << VariantIndex::chromName(chromId)
+                         << ":" << site
+                         << " is missing from " << this->names_[i] << endl;
+                    throw LociNumberUnequal(this->names_[i]);
+                }
+            }
+        }
+
+        if (!excluded && inAllInputs) {
+            keptPositions.push_back(site);
+            for (size_t i = 0; i < nInputs; i++) {
+                if (this->roles_[i] != ALIGN_EXCLUDE) {
+                    this->keptRows_[i].push_back(this->inputs_[i]->siteIndex(
+                        cursors[i].chromI, cursors[i].posI));
+                }
+            }
+        }
+
+        for (auto &cursor : cursors) {
+            if (cursor.hasSite) {
+                cursor.posI++;
+            }
+        }
+    }
+
+    if (keptPositions.size() > 0) {
+        this->nSites_ += keptPositions.size();
+        this->chromId_.push_back(chromId);
+        this->chrom_.push_back(VariantIndex::chromName(chromId));
+        this->position_.push_back(keptPositions);
+    }
+}
+
+
+void SiteAligner::apply() {
+    for (size_t i = 0; i < this->inputs_.size(); i++) {
+        if (this->roles_[i] == ALIGN_EXCLUDE) {
+            continue;
+        }
+        VariantIndex * input = this->inputs_[i];
+        input->chrom_ = this->chrom_;
+        input->chromId_ = this->chromId_;
+        input->position_ = this->position_;
+        input->setDoneGetIndexOfChromStarts(false);
+        input->getIndexOfChromStarts();
+        input->indexOfContentToBeKept = this->keptRows_[i];
+        input->removeMarkers();
+        input->indexOfContentToBeKept.clear();
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_SITEALIGNER_HPP_
+#define DEPLOID_SRC_SITEALIGNER_HPP_
+
+#include <vector>
+#include <string>
+#include "variantIndex.hpp"
+
+using std::vector;
+using std::string;
+
+/*! How the sites of one input take part in the alignment */
+enum AlignRole {
+    // Every site must be in every strict input, a site that is missing from
+    // one of them throws LociNumberUnequal naming that input
+    ALIGN_STRICT,
+    // Sites missing from this input are dropped from all inputs
+    ALIGN_INTERSECT,
+    // Sites in this input are dropped from all inputs, e.g. ExcludeMarker
+    ALIGN_EXCLUDE
+};
+
+
+/*! \brief Aligns several inputs on (CHROM, POS) in one pass
+ *
+ *  The positions of all inputs are merged chromosome by chromosome with a
+ *  k-way sorted merge. The result is one shared list of sites, and for each
+ *  input the rows that hold these sites. Mismatches between strict inputs
+ *  are found during the merge.
+ */
+class SiteAligner {
+#ifdef UNITTEST
+    friend class TestSiteAligner;
+#endif
+ public:
+    SiteAligner() {}
+    ~SiteAligner() {}
+
+    void addInput(VariantIndex * input, const string & name,
+                  AlignRole role = ALIGN_STRICT);
+    void align();
+    // Restrict every input that is not an exclude list to the aligned sites
+    void apply();
+
+    size_t nInputs() const { return this->inputs_.size(); }
+    size_t nSites() const { return this->nSites_; }
+    const vector <string> & chrom() const { return this->chrom_; }
+    const vector <ChromId> & chromId() const { return this->chromId_; }
+    const Csr <int> & position() const { return this->position_; }
+    /* Rows of input inputI that hold the aligned sites, in site order,
+     * empty for exclude lists */
+    const vector <size_t> & keptRows(size_t inputI) const {
+        return this->keptRows_[inputI]; }
+
+ private:
+    vector <VariantIndex *> inputs_;
+    vector <string> names_;
+    vector <AlignRole> roles_;
+
+    size_t nSites_;
+    vector <string> chrom_;
+    vector <ChromId> chromId_;
+    Csr <int> position_;
+    vector < vector <size_t> > keptRows_;
+
+    void alignChrom(const ChromId chromId);
+};
+
+#endif  // DEPLOID_SRC_SITEALIGNER_HPP_
@@ -0,0 +1,220 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>  // getenv, strtol
+#include "threadPool.hpp"
+
+
+ThreadPool::ThreadPool(const size_t nThreads) {
+    this->stopping_ = false;
+    this->setNumThreads(nThreads);
+}
+
+
+ThreadPool::~ThreadPool() {
+    this->stopWorkers();
+}
+
+
+ThreadPool & ThreadPool::shared() {
+    static ThreadPool pool(0);
+    static std::once_flag readEnvironment;
+    std::call_once(readEnvironment, []() {
+        const char * budget = getenv("DEPLOID_NUM_THREADS");
+        if (budget != NULL) {
+            long nThreads = strtol(budget, NULL, 10);  // NOLINT
+            pool.setNumThreads((nThreads > 0) ? nThreads : 0);
+        }
+    });
+    return pool;
+}
+
+
+void ThreadPool::setNumThreads(const size_t nThreads) {
+    this->stopWorkers();
+    this->nThreads_ = (nThreads > 0) ?
+        nThreads : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+
+void ThreadPool::startWorkers(const size_t nWorkers) {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->stopping_ = false;
+    while (this->workers_.size() < nWorkers) {
+        this->workers_.push_back(std::thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+
+void ThreadPool::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->stopping_ = true;
+    }
+    this->wakeUp_.notify_all();
+    for (auto &worker : this->workers_) {
+        worker.join();
+    }
+    this->workers_.clear();
+    this->stopping_ = false;
+}
+
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::shared_ptr <Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex_);
+            while (!this->stopping_ && this->queue_.empty()) {
+                this->wakeUp_.wait(lock);
+            }
+            if (this->queue_.empty()) {
+                return;
+            }
+            batch = this->queue_.front();
+            this->queue_.pop_front();
+        }
+        runBatch(batch.get());
+    }
+}
+
+
+bool ThreadPool::nextTask(Batch * batch, const size_t shareI, size_t * task) {
+    Share & own = batch->shares[shareI];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+            *task = own.begin++;
+            return true;
+        }
+    }
+    // Steal the back half of the first share that has tasks left
+    size_t nShares = batch->shares.size();
+    for (size_t i = 1; i < nShares; i++) {
+        Share & victim = batch->shares[(shareI + i) % nShares];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) {
+                continue;
+            }
+            end = victim.end;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        *task = begin;
+        return true;
+    }
+    return false;
+}
+
+
+void ThreadPool::runBatch(Batch * batch) {
+    size_t shareI = batch->nextShare++;
+    if (shareI >= batch->shares.size()) {
+        return;
+    }
+    size_t i;
+    while (nextTask(batch, shareI, &i)) {
+        try {
+            (*batch->task)(i);
+        } catch (...) {
+            batch->errors[i] = std::current_exception();
+        }
+        if (++batch->done == batch->n) {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->finished.notify_all();
+        }
+    }
+}
+
+
+void ThreadPool::parallelFor(const size_t n,
+                             const std::function<void(size_t)> & task) {
+    if (n == 0) {
+        return;
+    }
+    size_t nShares = std::min(n, this->nThreads_);
+    if (nShares <= 1) {
+        // Serial, the first exception is the one of the lowest i
+        for (size_t i = 0; i < n; i++) {
+            task(i);
+        }
+        return;
+    }
+    this->startWorkers(this->nThreads_ - 1);
+
+    // Queued as a shared pointer, a worker may pick it up after the last
+    // task is done and this call has returned
+    std::shared_ptr <Batch> batch(new Batch(nShares));
+    batch->task = &task;
+    batch->n = n;
+    batch->nextShare = 0;
+    batch->done = 0;
+    batch->errors.resize(n);
+    for (size_t i = 0; i < nShares; i++) {
+        batch->shares[i].begin = i * n / nShares;
+        batch->shares[i].end = (i + 1) * n / nShares;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        for (size_t i = 1; i < nShares; i++) {
+            this->queue_.push_back(batch);
+        }
+    }
+    this->wakeUp_.notify_all();
+
+    runBatch(batch.get());
+    {
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        while (batch->done < n) {
+            batch->finished.wait(lock);
+        }
+    }
+
+    for (auto const &error : batch->errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+
+void ThreadPool::parallelFor(const size_t begin, const size_t end,
+                             const size_t grain,
+                             const std::function<void(size_t, size_t)> & task) {
+    if (end <= begin) {
+        return;
+    }
+    size_t step = std::max(grain, static_cast<size_t>(1));
+    size_t nChunks = (end - begin + step - 1) / step;
+    this->parallelFor(nChunks, [&](size_t chunk) {
+        size_t chunkBegin = begin + chunk * step;
+        task(chunkBegin, std::min(chunkBegin + step, end));
+    });
+}
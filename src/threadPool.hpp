@@ -0,0 +1,150 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_THREADPOOL_HPP_
+#define DEPLOID_SRC_THREADPOOL_HPP_
+
+#include <algorithm>  // min
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/*! \brief Work-stealing pool of threads shared by the library
+ *
+ *  Every parallel part of the library runs its tasks here, rather than
+ *  starting threads of its own. The tasks of a parallelFor() call are split
+ *  into one contiguous share per thread. A thread works from the front of its
+ *  share, and when it runs out it steals the back half of the share of
+ *  another thread. The calling thread takes a share too, so a call made from
+ *  inside a task never waits for workers that are busy.
+ *
+ *  The thread budget is the most threads one call uses, the caller included.
+ *  It is set with setNumThreads(), or with the DEPLOID_NUM_THREADS
+ *  environment variable for the shared pool. A budget of one runs everything
+ *  on the calling thread, without a budget there is one thread per core.
+ *  When a host application is already using cores, a thread that is not
+ *  scheduled loses the rest of its share to the threads that are, so a call
+ *  never waits for it. Workers are only started when a call needs them, and
+ *  sleep when there is no work.
+ *
+ *  Results are written by task index, and parallelReduce() combines chunks in
+ *  order, so the output never depends on which thread ran which task.
+ */
+class ThreadPool {
+ public:
+    /*! A pool of nThreads threads, the caller included, 0 for automatic */
+    explicit ThreadPool(const size_t nThreads);
+    ~ThreadPool();
+
+    /*! The pool used by the library, its budget is DEPLOID_NUM_THREADS if
+     *  that is set, and automatic otherwise */
+    static ThreadPool & shared();
+
+    /*! Set the thread budget, 0 for automatic. Must not be called while
+     *  tasks of this pool run. */
+    void setNumThreads(const size_t nThreads);
+    /*! Most threads a call uses, the caller included */
+    size_t nThreads() const { return this->nThreads_; }
+
+    /*! Run task(i) for every i in [0, n) and wait for all of them. If tasks
+     *  throw, the exception of the lowest i is rethrown. */
+    void parallelFor(const size_t n, const std::function<void(size_t)> & task);
+    /*! Run task(chunkBegin, chunkEnd) over [begin, end) in chunks of grain */
+    void parallelFor(const size_t begin, const size_t end, const size_t grain,
+                     const std::function<void(size_t, size_t)> & task);
+    /*! Combine map(chunkBegin, chunkEnd) over [begin, end) in chunks of
+     *  grain, in chunk order, so the result does not depend on the threads */
+    template <class T, class Map, class Combine>
+    T parallelReduce(const size_t begin, const size_t end, const size_t grain,
+                     const T & identity, Map map, Combine combine);
+
+ private:
+    ThreadPool(const ThreadPool &);
+    ThreadPool & operator=(const ThreadPool &);
+
+    // Tasks [begin, end) of one thread, others steal from the end
+    struct Share {
+        std::mutex mutex;
+        size_t begin;
+        size_t end;
+    };
+    // The tasks of one parallelFor() call
+    struct Batch {
+        const std::function<void(size_t)> * task;
+        size_t n;
+        vector <Share> shares;
+        std::atomic<size_t> nextShare;
+        std::atomic<size_t> done;
+        vector <std::exception_ptr> errors;
+        std::mutex mutex;
+        std::condition_variable finished;
+        explicit Batch(size_t nShares) : shares(nShares) {}
+    };
+    static void runBatch(Batch * batch);
+    static bool nextTask(Batch * batch, const size_t shareI, size_t * task);
+
+    void startWorkers(const size_t nWorkers);
+    void stopWorkers();
+    void workerLoop();
+
+    size_t nThreads_;
+    vector <std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wakeUp_;
+    std::deque < std::shared_ptr <Batch> > queue_;
+    bool stopping_;
+};
+
+
+template <class T, class Map, class Combine>
+T ThreadPool::parallelReduce(const size_t begin, const size_t end,
+                             const size_t grain, const T & identity,
+                             Map map, Combine combine) {
+    if (end <= begin) {
+        return identity;
+    }
+    size_t step = std::max(grain, static_cast<size_t>(1));
+    size_t nChunks = (end - begin + step - 1) / step;
+    vector <T> partial(nChunks, identity);
+    this->parallelFor(nChunks, [&](size_t chunk) {
+        size_t chunkBegin = begin + chunk * step;
+        partial[chunk] = map(chunkBegin, std::min(chunkBegin + step, end));
+    });
+    T result = identity;
+    for (auto const &value : partial) {
+        result = combine(result, value);
+    }
+    return result;
+}
+
+#endif  // DEPLOID_SRC_THREADPOOL_HPP_
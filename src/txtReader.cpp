@@ -26,120 +26,424 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
-#include <iterator>     // std::distance
+#include <iterator>     // std::distance, std::istreambuf_iterator
+#include <cstring>      // memcmp
+#include "binaryPanel.hpp"
 #include "exceptions.hpp"
+#include "rowEstimate.hpp"
 #include "txtReader.hpp"
 
 using std::min;
+using std::max;
+
+void TxtReader::reset() {
+    this->in_.close();
+
+    this->content_.clear();
+    this->info_.clear();
+    this->header_.clear();
+    this->nInfoLines_ = 0;
+    this->resetIndex();
+}
+
 
 void TxtReader::readFromFileBase(const char inchar[]) {
-    this->fileName_ = string(inchar);
-    this->checkFileCompressed();
+    this->readFromSourceBase(InputSource::fromName(string(inchar)));
+}
+
+
+void TxtReader::readFromSourceBase(const InputSource & source) {
+    // A reader can be read into again, the last file is dropped first
+    this->reset();
+    this->fileName_ = source.name();
+    // Compression and the binary magic are found from the first bytes, on
+    // the same handle
+    this->in_.open(source);
+    dout << "Check if text file is compressed " << this->isCompressed()
+         << std::endl;
 
-    if (this->isCompressed()) {
-        this->inFileGz.open(this->fileName_.c_str(), std::ios::in);
+    if (this->isBinary()) {
+        this->readBinary(source);
     } else {
-        this->inFile.open(this->fileName_.c_str(), std::ios::in);
+        this->readFromTextFile(source);
     }
+    this->in_.close();
 
-    if (this->isCompressed()) {
-        if (!inFileGz.good()) {
-            throw InvalidInputFile(this->fileName_);
-        }
+    this->nLoci_ = this->content_.size();
+    this->nInfoLines_ = (this->nLoci_ > 0) ? this->content_.back().size() :
+                                            this->header_.size();
+
+    if (this->nInfoLines_ == 1) {
+        this->reshapeContentToInfo();
+    }
+
+    this->getIndexOfChromStarts();
+    assert(chrom_.size() == position_.size());
+    assert(this->doneGetIndexOfChromStarts_ == true);
+    this->checkSortedPositions(this->fileName_);
+}
+
+
+bool TxtReader::isBinary() const {
+    size_t nHead;
+    const char * head = this->in_.head(&nHead);
+    return nHead == 8 && memcmp(head, BinaryPanel::magic_, 8) == 0;
+}
+
+
+void TxtReader::readBinary(const InputSource & source) {
+    if (source.isPath()) {
+        // Mapped rather than read
+        this->in_.close();
+        BinaryPanel::read(this->fileName_, this);
+    } else if (source.kind() == InputSource::MEMORY) {
+        BinaryPanel::read(source.data(), source.size(), this->fileName_, this);
     } else {
-        if (!inFile.good()) {
-            throw InvalidInputFile(this->fileName_);
-        }
+        string panel((std::istreambuf_iterator<char>(this->in_)),
+                     std::istreambuf_iterator<char>());
+        BinaryPanel::read(panel.data(), panel.size(), this->fileName_, this);
+    }
+}
+
+
+void TxtReader::readFromTextFile(const InputSource & source) {
+    if (!this->in_.good()) {
+        throw InvalidInputFile(this->fileName_);
     }
 
     tmpChromInex_ = -1;
     string tmp_line;
     // skip the first line, which is the header
-    if (this->isCompressed()) {
-        getline(inFileGz, tmp_line);
-    } else {
-        getline(inFile, tmp_line);
-    }
+    getline(this->in_, tmp_line);
     this->extractHeader(tmp_line);
 
-    if (this->isCompressed()) {
-        getline(inFileGz, tmp_line);
+    LineIndex index;
+    GzIndex gzIndex;
+    bool indexed = false;
+    if (this->useLineIndex_ && source.isPath()) {
+        indexed = this->isCompressed() ?
+                  gzIndex.loadOrBuild(this->fileName_, 1, &index) :
+                  index.loadOrBuild(this->fileName_, 1);
+    }
+    if (indexed) {
+        this->readBodyIndexed(index,
+                              this->isCompressed() ? &gzIndex : NULL);
+    } else if (this->nThreads_ > 1) {
+        this->readBodyParallel();
     } else {
-        getline(inFile, tmp_line);
-    }
-
-    while (inFile.good() && tmp_line.size() > 0) {
-        size_t field_start = 0;
-        size_t field_end = 0;
-        size_t field_index = 0;
-        vector <double> contentRow;
-        while (field_end < tmp_line.size()) {
-            field_end = min(
-                min(
-                    min(tmp_line.find(' ', field_start),
-                    tmp_line.find(',', field_start)),
-                    tmp_line.find('\t', field_start)),
-                    tmp_line.find('\n', field_start));
-
-            string tmp_str = tmp_line.substr(field_start,
-                field_end - field_start);
-            if (field_index > 1) {
-                contentRow.push_back(strtod(tmp_str.c_str(), NULL));
-            } else if (field_index == 0) {
-                this->extractChrom(tmp_str);
-            } else if (field_index == 1) {
-                this->extractPOS(tmp_str);
-            }
-
-            field_start = field_end+1;
-            field_index++;
+        // Only a file can be sampled for an estimate, a pipe is read once
+        if (source.isPath()) {
+            this->reserveRows(
+                RowEstimate::ofFile(this->fileName_, 1).reserveSize());
         }
-        this->content_.push_back(contentRow);
+        this->readBodySerial();
+    }
+}
+
+
+size_t TxtReader::extractSite(const string & line, string & chromStr,
+                              string & posStr, size_t & contentStart) const {
+    size_t field_start = 0;
+    size_t field_end = 0;
+    size_t field_index = 0;
+    while (field_end < line.size() && field_index < 2) {
+        field_end = min(
+            min(
+                min(line.find(' ', field_start),
+                line.find(',', field_start)),
+                line.find('\t', field_start)),
+                line.find('\n', field_start));
 
-        if (this->isCompressed()) {
-            getline(inFileGz, tmp_line);
+        if (field_index == 0) {
+            chromStr = line.substr(field_start, field_end - field_start);
         } else {
-            getline(inFile, tmp_line);
+            posStr = line.substr(field_start, field_end - field_start);
         }
+
+        field_start = field_end+1;
+        field_index++;
     }
+    // npos when the row ends before the content fields
+    contentStart = (field_end < line.size()) ? field_start : string::npos;
+    return field_index;
+}
 
-    if (this->isCompressed()) {
-        this->inFileGz.close();
-    } else {
-        this->inFile.close();
+
+void TxtReader::extractContent(const string & line, size_t field_start,
+                               vector <double> * contentRow) const {
+    if (field_start == string::npos) {
+        return;
     }
+    // Counted first, so a new row is allocated at its exact size
+    size_t nFields = 1;
+    for (size_t i = field_start; i < line.size(); i++) {
+        char c = line[i];
+        nFields += (c == ' ' || c == ',' || c == '\t' || c == '\n');
+    }
+    contentRow->reserve(contentRow->size() + nFields);
+    size_t field_end = 0;
+    while (field_end < line.size()) {
+        field_end = min(
+            min(
+                min(line.find(' ', field_start),
+                line.find(',', field_start)),
+                line.find('\t', field_start)),
+                line.find('\n', field_start));
 
-    this->position_.push_back(this->tmpPosition_);
+        // Converted in place, strtod stops at the delimiter. An empty field
+        // is 0, strtod would skip the delimiter and read the next field.
+        contentRow->push_back((field_end == field_start) ? 0.0 :
+                              strtod(line.c_str() + field_start, NULL));
 
-    this->nLoci_ = this->content_.size();
-    this->nInfoLines_ = this->content_.back().size();
+        field_start = field_end+1;
+    }
+}
 
-    if (this->nInfoLines_ == 1) {
-        this->reshapeContentToInfo();
+
+void TxtReader::setAllowedPositions(const VariantIndex & sites) {
+    // Positions of a loaded reader are already sorted
+    this->allowedChromId_ = sites.chromId_;
+    this->allowedPosition_ = sites.position_;
+    this->useAllowedPositions_ = true;
+}
+
+
+void TxtReader::setAllowedPositions(const vector <string> & chrom,
+                                    const vector < vector <int> > & position) {
+    assert(chrom.size() == position.size());
+    this->allowedChromId_.clear();
+    for (auto const &name : chrom) {
+        this->allowedChromId_.push_back(ChromDictionary::global().intern(name));
     }
+    this->allowedPosition_.clear();
+    for (auto const &positions : position) {
+        vector <int> sortedPositions(positions);
+        std::sort(sortedPositions.begin(), sortedPositions.end());
+        this->allowedPosition_.push_back(sortedPositions);
+    }
+    this->useAllowedPositions_ = true;
+}
 
-    this->getIndexOfChromStarts();
-    assert(tmpChromInex_ > -1);
-    assert(chrom_.size() == position_.size());
-    assert(this->doneGetIndexOfChromStarts_ == true);
-    this->checkSortedPositions(this->fileName_);
+
+void TxtReader::clearAllowedPositions() {
+    this->allowedChromId_.clear();
+    this->allowedPosition_.clear();
+    this->useAllowedPositions_ = false;
 }
 
 
-void TxtReader::checkFileCompressed() {
-    FILE *f = NULL;
-    f = fopen(this->fileName_.c_str(), "rb");
-    if (f == NULL) {
-        throw InvalidInputFile(this->fileName_);
+bool TxtReader::isAllowed(const ChromId chromId, const int pos) const {
+    if (!this->useAllowedPositions_) {
+        return true;
+    }
+    for (size_t chromI = 0; chromI < this->allowedChromId_.size(); chromI++) {
+        if (this->allowedChromId_[chromI] == chromId) {
+            return std::binary_search(this->allowedPosition_[chromI].begin(),
+                                      this->allowedPosition_[chromI].end(),
+                                      pos);
+        }
+    }
+    return false;
+}
+
+
+void TxtReader::reserveRows(size_t nRows) {
+    // No more rows than the allow-list has sites are kept
+    if (this->useAllowedPositions_) {
+        nRows = min(nRows, this->allowedPosition_.nValues());
+    }
+    this->content_.reserve(nRows);
+    this->position_.reserve(0, nRows);
+}
+
+
+void TxtReader::readBodySerial() {
+    string tmp_line;
+    string chromStr;
+    string posStr;
+    size_t contentStart;
+    while (true) {
+        // A last line without a newline is read too, getline() only fails
+        // after it
+        if (!getline(this->in_, tmp_line) || tmp_line.size() == 0) {
+            break;
+        }
+
+        size_t nSiteFields = this->extractSite(tmp_line, chromStr, posStr,
+                                               contentStart);
+        int pos = (nSiteFields > 1) ? this->convertPOS(posStr) : 0;
+        ChromId chromId = ChromDictionary::global().intern(chromStr);
+        // Rows that are not on the allow-list are dropped before the content
+        // is converted
+        if (!this->isAllowed(chromId, pos)) {
+            continue;
+        }
+        this->extractChrom(chromId);
+        if (nSiteFields > 1) {
+            this->position_.append(pos);
+        }
+        // Parsed in place, the row is allocated at its exact size
+        this->content_.push_back(vector <double>());
+        this->extractContent(tmp_line, contentStart, &this->content_.back());
+    }
+}
+
+
+/*! Read the rest of the file into memory, cut it into newline-aligned chunks,
+ *  one per thread, and parse the chunks on the shared thread pool, which
+ *  bounds how many run at once. The chunks are merged in
+ *  file order, so the result is identical to the serial reader, and the first
+ *  error in file order is the one that is thrown.
+ */
+void TxtReader::readBodyParallel() {
+    string body((std::istreambuf_iterator<char>(this->in_)),
+                std::istreambuf_iterator<char>());
+
+    // The serial reader stops at the first empty line
+    size_t bodyEnd = (body.size() > 0 && body[0] == '\n') ?
+                     0 : body.find("\n\n");
+    if (bodyEnd != string::npos) {
+        body.resize((bodyEnd == 0) ? 0 : bodyEnd + 1);
+    }
+
+    // All rows are in memory, so their number is known
+    size_t nRows = std::count(body.begin(), body.end(), '\n');
+    this->reserveRows((body.empty() || body.back() == '\n') ?
+                      nRows : nRows + 1);
+
+    vector <size_t> chunkStarts(1, 0);
+    for (size_t i = 1; i < this->nThreads_; i++) {
+        size_t cut = body.find('\n', max(chunkStarts.back(),
+                                         i * body.size() / this->nThreads_));
+        if (cut == string::npos || cut + 1 >= body.size()) {
+            break;
+        }
+        chunkStarts.push_back(cut + 1);
+    }
+    chunkStarts.push_back(body.size());
+
+    vector <TxtChunk> chunks(chunkStarts.size() - 1);
+    ThreadPool::shared().parallelFor(chunks.size(), [&](size_t i) {
+        this->parseChunk(body.data() + chunkStarts[i],
+                         body.data() + chunkStarts[i+1], &chunks[i]);
+    });
+
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (chunks[i].error_) {
+            std::rethrow_exception(chunks[i].error_);
+        }
+        this->mergeChunk(&chunks[i]);
+    }
+}
+
+
+/*! Read the data through its line index. Only the chromosomes on the
+ *  allow-list are read, and each chunk is read from the file by the task
+ *  that parses it, so the data is never in memory as a whole. A gzipped
+ *  file is inflated chunk by chunk from the access points of gz.
+ */
+void TxtReader::readBodyIndexed(const LineIndex & index, const GzIndex * gz) {
+    vector <LineRange> ranges = index.select([this](const string & chrom) {
+        if (!this->useAllowedPositions_) {
+            return true;
+        }
+        ChromId chromId;
+        return ChromDictionary::global().find(chrom, &chromId) &&
+               std::find(this->allowedChromId_.begin(),
+                         this->allowedChromId_.end(), chromId) !=
+               this->allowedChromId_.end();
+    });
+    size_t nRows = 0;
+    for (auto const &range : ranges) {
+        nRows += range.nLines;
+    }
+    this->reserveRows(nRows);
+
+    // The chunks of a range are in proportion to its number of lines
+    vector <LineRange> chunkRanges;
+    for (auto const &range : ranges) {
+        size_t nChunks = (range.nLines * this->nThreads_ + nRows - 1) / nRows;
+        vector <LineRange> rangeChunks = index.chunks(range, nChunks);
+        chunkRanges.insert(chunkRanges.end(), rangeChunks.begin(),
+                           rangeChunks.end());
     }
 
-    unsigned char magic[2];
+    vector <TxtChunk> chunks(chunkRanges.size());
+    ThreadPool::shared().parallelFor(chunks.size(), [&](size_t i) {
+        string bytes;
+        try {
+            if (gz != NULL) {
+                gz->extract(this->fileName_, chunkRanges[i].begin,
+                            chunkRanges[i].end, &bytes);
+            } else {
+                LineIndex::readRange(this->fileName_, chunkRanges[i].begin,
+                                     chunkRanges[i].end, &bytes);
+            }
+        } catch (...) {
+            chunks[i].error_ = std::current_exception();
+            return;
+        }
+        this->parseChunk(bytes.data(), bytes.data() + bytes.size(),
+                         &chunks[i]);
+    });
 
-    size_t freadResults = fread(reinterpret_cast<void *>(magic), 1, 2, f);
-    dout << "Check if text file is compressed " << freadResults << std::endl;
-    this->setIsCompressed((static_cast<int>(magic[0]) == 0x1f) &&
-                          (static_cast<int>(magic[1]) == 0x8b));
-    fclose(f);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (chunks[i].error_) {
+            std::rethrow_exception(chunks[i].error_);
+        }
+        this->mergeChunk(&chunks[i]);
+    }
+}
+
+
+void TxtReader::parseChunk(const char * begin, const char * end,
+                           TxtChunk * chunk) const {
+    try {
+        string tmp_line;
+        string chromStr;
+        string posStr;
+        size_t contentStart;
+        while (begin < end) {
+            const char * lineEnd = std::find(begin, end, '\n');
+            tmp_line.assign(begin, lineEnd);
+            begin = (lineEnd < end) ? lineEnd + 1 : end;
+
+            size_t nSiteFields = this->extractSite(tmp_line, chromStr, posStr,
+                                                   contentStart);
+            int pos = (nSiteFields > 1) ? this->convertPOS(posStr) : 0;
+            ChromId chromId = ChromDictionary::global().intern(chromStr);
+            if (!this->isAllowed(chromId, pos)) {
+                continue;
+            }
+            // Same boundary rule as extractChrom(), a new chromosome starts
+            // whenever the id differs from the previous row.
+            if (chunk->chromId_.size() == 0 ||
+                    chromId != chunk->chromId_.back()) {
+                chunk->chromId_.push_back(chromId);
+                chunk->position_.newRow();
+            }
+            if (nSiteFields > 1) {
+                chunk->position_.append(pos);
+            }
+            chunk->rows_.push_back(vector <double>());
+            this->extractContent(tmp_line, contentStart,
+                                 &chunk->rows_.back());
+        }
+    } catch (...) {
+        chunk->error_ = std::current_exception();
+    }
+}
+
+
+void TxtReader::mergeChunk(TxtChunk * chunk) {
+    for (size_t chromI = 0; chromI < chunk->chromId_.size(); chromI++) {
+        this->extractChrom(chunk->chromId_[chromI]);
+        this->position_.append(chunk->position_[chromI].begin(),
+                               chunk->position_[chromI].end());
+    }
+    for (auto &row : chunk->rows_) {
+        this->content_.push_back(std::move(row));
+    }
 }
 
 
@@ -168,28 +472,25 @@ void TxtReader::extractHeader(const string &line) {
 }
 
 
-void TxtReader::extractChrom(const string & tmp_str) {
+void TxtReader::extractChrom(const ChromId chromId) {
     if (tmpChromInex_ >= 0) {
-        if (tmp_str != this->chrom_.back()) {
+        if (chromId != this->chromId_.back()) {
             tmpChromInex_++;
-            // save current positions
-            this->position_.push_back(this->tmpPosition_);
-
             // start new chrom
-            this->tmpPosition_.clear();
-            this->chrom_.push_back(tmp_str);
+            this->position_.newRow();
+            this->addChrom(chromId);
         }
     } else {
         tmpChromInex_++;
         assert(this->chrom_.size() == 0);
-        this->chrom_.push_back(tmp_str);
-        assert(this->tmpPosition_.size() == 0);
         assert(this->position_.size() == 0);
+        this->addChrom(chromId);
+        this->position_.newRow();
     }
 }
 
 
-void TxtReader::extractPOS(const string & tmp_str) {
+int TxtReader::convertPOS(const string & tmp_str) const {
     if (tmp_str.find("e") != std::string::npos) {
         throw BadScientificNotation(tmp_str, this->fileName_);
     }
@@ -204,12 +505,13 @@ void TxtReader::extractPOS(const string & tmp_str) {
     } catch ( const std::exception &e) {
         throw BadConversion(tmp_str, this->fileName_);
     }
-    this->tmpPosition_.push_back(ret);
+    return ret;
 }
 
 
 void TxtReader::reshapeContentToInfo() {
     assert(this->info_.size() == 0);
+    this->info_.reserve(this->content_.size());
     for (size_t i = 0; i < this->content_.size(); i++) {
         this->info_.push_back(this->content_[i][0]);
     }
@@ -217,19 +519,10 @@ void TxtReader::reshapeContentToInfo() {
 
 
 void TxtReader::removeMarkers() {
-    assert(this->keptContent_.size() == static_cast<size_t>(0));
-    for (auto const &value : this->indexOfContentToBeKept) {
-        this->keptContent_.push_back(this->content_[value]);
-    }
-
-    this->content_.clear();
-    assert(this->content_.size() == static_cast<size_t>(0));
-    this->content_ = this->keptContent_;
-    this->keptContent_.clear();
+    keepRowsInPlace(&this->content_, this->indexOfContentToBeKept);
 
     if (this->nInfoLines_ == 1) {
-        this->info_.clear();
-        this->reshapeContentToInfo();
+        keepRowsInPlace(&this->info_, this->indexOfContentToBeKept);
     }
     this->nLoci_ = this->content_.size();
 }
@@ -27,17 +27,39 @@
 #ifndef TXTREADER
 #define TXTREADER
 
+#include <exception>
 #include <vector>
 #include <string>
+#include "inputSource.hpp"
+#include "gzIndex.hpp"
+#include "lineIndex.hpp"
 #include "variantIndex.hpp"
 #include "exceptions.hpp"
-#include "gzstream/gzstream.h"
+
+/*! \brief Rows, chromosome runs and positions parsed from one newline-aligned
+ *  block of a text file, merged back in file order by TxtReader.
+ *
+ *  Each row is parsed straight into a vector of its exact size, which is
+ *  moved into the content of the reader when the chunk is merged. */
+struct TxtChunk {
+    vector <ChromId> chromId_;
+    Csr < int > position_;
+    vector < vector <double> > rows_;
+    std::exception_ptr error_;
+};
+
 
 class TxtReader : public VariantIndex {
     #ifdef UNITTEST
     friend class TestPanel;
     friend class TestTxtReader;
     friend class TestInitialHaplotypes;
+    friend class TestSiteAligner;
+    friend class TestThreadPool;
+    friend class TestInputLoader;
+    friend class TestInputSource;
+    friend class TestLineIndex;
+    friend class TestGzIndex;
     #endif
     friend class McmcMachinery;
     friend class UpdateSingleHap;
@@ -45,18 +67,15 @@ class TxtReader : public VariantIndex {
     friend class UpdateHap;
     friend class Panel;
     friend class DEploidIO;
+    friend class BinaryPanel;
+    friend class DvcfAccess;
  private:
     // Members
     string fileName_;
-    ifstream inFile;
-    igzstream inFileGz;
-    bool isCompressed_;
-    bool isCompressed() const { return this->isCompressed_; }
-    void setIsCompressed(const bool compressed) {
-        this->isCompressed_ = compressed; }
-    void checkFileCompressed();
+    InputStream in_;
+    bool isCompressed() const { return this->in_.isCompressed(); }
+    bool isBinary() const;
     // content is a matrix of n.loci by n.strains, i.e. content length is n.loci
-    vector < vector < double > > keptContent_;
     // info_ only refers to the first column of the content
     vector <double> info_;
 
@@ -64,20 +83,71 @@ class TxtReader : public VariantIndex {
     size_t nInfoLines_;
 
     int tmpChromInex_;
-    vector < int > tmpPosition_;
+    size_t nThreads_;
+    bool useLineIndex_;
+
+    // Sites to load, rows elsewhere are skipped before they are converted
+    bool useAllowedPositions_;
+    vector <ChromId> allowedChromId_;
+    Csr < int > allowedPosition_;
 
     // Methods
-    void extractChrom(const string & tmp_str);
-    void extractPOS(const string & tmp_str);
+    void extractChrom(const ChromId chromId);
+    int convertPOS(const string & tmp_str) const;
+    size_t extractSite(const string & line, string & chromStr,
+                       string & posStr, size_t & contentStart) const;
+    void extractContent(const string & line, size_t field_start,
+                        vector <double> * contentRow) const;
+    bool isAllowed(const ChromId chromId, const int pos) const;
+    void reserveRows(size_t nRows);
+    void readFromTextFile(const InputSource & source);
+    void readBinary(const InputSource & source);
+    void readBodySerial();
+    void readBodyParallel();
+    void readBodyIndexed(const LineIndex & index, const GzIndex * gz);
+    void parseChunk(const char * begin, const char * end,
+                    TxtChunk * chunk) const;
+    void mergeChunk(TxtChunk * chunk);
     void extractHeader(const string &line);
     void reshapeContentToInfo();
 
  public:  // move the following to private
     vector < vector < double > > content_;
-    TxtReader() {}
+    TxtReader() {
+        this->tmpChromInex_ = -1;
+        this->setNumThreads(1);
+        this->useAllowedPositions_ = false;
+        this->useLineIndex_ = false;
+    }
+    /* Number of chunks the body of the file is parsed in, at most
+     * ThreadPool::shared().nThreads() of them at once. The default of one
+     * keeps the original line by line reader. */
+    void setNumThreads(const size_t nThreads) {
+        this->nThreads_ = (nThreads > 0) ? nThreads : 1; }
+    size_t nThreads() const { return this->nThreads_; }
+    /* Read text files through their LineIndex sidecar, which is written on
+     * the first read. The chunks are cut at sampled lines and read in
+     * parallel, and chromosomes that are not on the allow-list are never
+     * read. A single member gzipped file also gets a GzIndex sidecar, and
+     * its chunks are inflated in parallel. */
+    void setUseLineIndex(const bool use) { this->useLineIndex_ = use; }
+    /* Only load rows at these sites, e.g. the sites of a loaded VcfReader,
+     * so that the full panel is never held in memory. */
+    void setAllowedPositions(const VariantIndex & sites);
+    void setAllowedPositions(const vector <string> & chrom,
+                             const vector < vector <int> > & position);
+    void clearAllowedPositions();
     virtual void readFromFile(const char inchar[]) {
         this->readFromFileBase(inchar); }
+    /* Close the file and forget its content, keeping the capacity. The
+     * allowed positions and the number of chunks are kept. */
+    void reset();
     void readFromFileBase(const char inchar[]);
+    /* Read from a pipe, standard input or memory, the file name "-" is
+     * standard input too */
+    virtual void readFromSource(const InputSource & source) {
+        this->readFromSourceBase(source); }
+    void readFromSourceBase(const InputSource & source);
     virtual ~TxtReader() {}
     void removeMarkers();
 };
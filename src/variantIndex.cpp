@@ -23,8 +23,9 @@
  *
  */
 
-#include <algorithm>  // find
+#include <algorithm>  // find, lower_bound, upper_bound
 #include <iostream>
+#include "chromSubset.hpp"
 #include "exceptions.hpp"
 #include "txtReader.hpp"
 #include "variantIndex.hpp"
@@ -32,6 +33,8 @@
 using std::min;
 using std::endl;
 
+const size_t VariantIndex::npos = static_cast<size_t>(-1);
+
 
 VariantIndex::VariantIndex() {
     this->init();
@@ -40,38 +43,38 @@ VariantIndex::VariantIndex() {
 void VariantIndex::findWhoToBeKept(ExcludeMarker* excludedMarkers) {
     dout << " Starts findWhoToBeKept " << endl;
     assert(this->indexOfContentToBeKept.size() == 0);
-    assert(this->indexOfPosToBeKept.size() == 0);
-
-    for (size_t chromI = 0; chromI < this->chrom_.size(); chromI++) {
-        dout << "   Going through chrom "<< chrom_[chromI];
-        vector < size_t > tmpindexOfPosToBeKept;
+    assert(this->indexOfPosToBeKept.empty());
 
+    // One task per chromosome, merged in chromosome order
+    size_t nChrom = this->chrom_.size();
+    vector < vector < size_t > > keptPos(nChrom);
+    ThreadPool::shared().parallelFor(nChrom, [&](size_t chromI) {
         // detemine if something needs to be removed from the current chrom.
-        vector<string>::iterator chromIt = find(excludedMarkers->chrom_.begin(),
-                                                excludedMarkers->chrom_.end(),
-                                                this->chrom_[chromI]);
-
-        size_t hapIndex = indexOfChromStarts_[chromI];
-        size_t chromIndexInExclude = std::distance(
-                                        excludedMarkers->chrom_.begin(),
-                                        chromIt);
-        for (size_t posI = 0; posI < this->position_[chromI].size(); posI++) {
-            if (chromIt == excludedMarkers->chrom_.end()) {
-                indexOfContentToBeKept.push_back(hapIndex);
-                tmpindexOfPosToBeKept.push_back(posI);
-            } else if (
-              std::find(excludedMarkers->position_[chromIndexInExclude].begin(),
-                        excludedMarkers->position_[chromIndexInExclude].end(),
-                        this->position_[chromI][posI]) ==
-                        excludedMarkers->position_[chromIndexInExclude].end()) {
-                indexOfContentToBeKept.push_back(hapIndex);
-                tmpindexOfPosToBeKept.push_back(posI);
+        size_t chromIndexInExclude = excludedMarkers->findChrom(
+                                        this->chromId_[chromI]);
+        bool chromIsExcluded = chromIndexInExclude <
+                               excludedMarkers->chrom_.size();
+        Span <int> excluded = chromIsExcluded ?
+            excludedMarkers->position_[chromIndexInExclude] : Span <int>();
+
+        Span <int> positions = this->position_[chromI];
+        for (size_t posI = 0; posI < positions.size(); posI++) {
+            // The exclude list is sorted when it is read
+            if (!std::binary_search(excluded.begin(), excluded.end(),
+                                    positions[posI])) {
+                keptPos[chromI].push_back(posI);
             }
-            hapIndex++;
         }
-        indexOfPosToBeKept.push_back(tmpindexOfPosToBeKept);
+    });
 
-        dout << " keeping " << tmpindexOfPosToBeKept.size() << endl;
+    for (size_t chromI = 0; chromI < nChrom; chromI++) {
+        dout << "   Going through chrom "<< chrom_[chromI]
+             << " keeping " << keptPos[chromI].size() << endl;
+        size_t hapIndex = indexOfChromStarts_[chromI];
+        for (auto const &posI : keptPos[chromI]) {
+            indexOfContentToBeKept.push_back(hapIndex + posI);
+        }
+        indexOfPosToBeKept.push_back(keptPos[chromI]);
     }
     assert(indexOfPosToBeKept.size() == this->chrom_.size());
 
@@ -91,125 +94,203 @@ void VariantIndex::findAndKeepMarkers(ExcludeMarker* excludedMarkers) {
 
 void VariantIndex::findWhoToBeKeptGivenIndex(
          const vector <size_t> & givenIndex) {
+    this->findWhoToBeKeptGivenIndex(givenIndex, ChromSubset::all(*this));
+}
+
+
+void VariantIndex::findWhoToBeKeptGivenIndexHalf(
+         const vector <size_t> & givenIndex) {
+    // Only the chromosomes after the first eleven
+    this->findWhoToBeKeptGivenIndex(givenIndex, ChromSubset::from(*this, 11));
+}
+
+
+void VariantIndex::findWhoToBeKeptGivenIndex(
+         const vector <size_t> & givenIndex, const ChromSubset & subset) {
     dout << " Starts findWhoToBeKeptGivenIndex " << endl;
     assert(this->indexOfContentToBeKept.size() == 0);
-    indexOfContentToBeKept = vector <size_t> (givenIndex.begin(),
-                                              givenIndex.end());
-    // assert(this->indexOfPosToBeKept.size() == 0);
-    vector <string> oldChrom = vector <string> (chrom_.begin(), chrom_.end());
-    this->chrom_.clear();
+    // Flag the given sites once, rather than searching the list per site
+    vector <bool> isGiven(this->nSites(), false);
+    for (auto const &siteI : givenIndex) {
+        assert(siteI < isGiven.size());
+        isGiven[siteI] = true;
+    }
+
+    vector <ChromId> oldChromId = std::move(this->chromId_);
+    this->clearChrom();
 
-    vector < vector < int > > oldposition = this->position_;
+    Csr < int > oldposition = std::move(this->position_);
     this->position_.clear();
 
-    for (size_t chromI = 0; chromI < oldChrom.size(); chromI++) {
-        dout << "   Going through chrom "<< oldChrom[chromI] << endl;
-        size_t hapIndex = indexOfChromStarts_[chromI];
-        vector <int> newTrimmedPos;
-        for (size_t posI = 0; posI < oldposition[chromI].size(); posI++) {
-            if (std::find(givenIndex.begin(), givenIndex.end(), hapIndex)
-                    != givenIndex.end()) {
-                if (newTrimmedPos.size() == 0) {
-                    this->chrom_.push_back(oldChrom[chromI]);
-                }
-                newTrimmedPos.push_back(oldposition[chromI][posI]);
+    // One task per chromosome, merged in chromosome order
+    vector < vector <size_t> > keptSites(subset.nChrom());
+    ThreadPool::shared().parallelFor(subset.nChrom(), [&](size_t i) {
+        const SiteRange & sites = subset.sites(i);
+        for (size_t siteI = sites.begin; siteI < sites.end; siteI++) {
+            if (isGiven[siteI]) {
+                keptSites[i].push_back(siteI);
             }
-
-            hapIndex++;
         }
-        this->position_.push_back(newTrimmedPos);
+    });
+
+    for (size_t i = 0; i < subset.nChrom(); i++) {
+        size_t chromI = subset.chromIndex(i);
+        dout << "   Going through chrom "
+             << this->chromName(oldChromId[chromI]) << endl;
+        // Chromosomes without kept sites are dropped, so the chromosomes and
+        // the rows of positions stay in step
+        if (keptSites[i].empty()) {
+            continue;
+        }
+        this->addChrom(oldChromId[chromI]);
+        this->position_.newRow();
+        for (auto const &siteI : keptSites[i]) {
+            this->indexOfContentToBeKept.push_back(siteI);
+            this->position_.append(oldposition.values()[siteI]);
+        }
     }
 
-    // assert(indexOfPosToBeKept.size() == this->chrom_.size());
+    dout << indexOfContentToBeKept.size() << " sites need to be Kept, with "
+         << this->chrom_.size() << endl;
+}
 
-    dout << indexOfContentToBeKept.size() << " sites need to be Kept " << endl;
+
+size_t VariantIndex::findChrom(const ChromId id) const {
+    return std::find(this->chromId_.begin(), this->chromId_.end(), id) -
+           this->chromId_.begin();
 }
 
 
-void VariantIndex::findWhoToBeKeptGivenIndexHalf(
-         const vector <size_t> & givenIndex) {
-    dout << " Starts findWhoToBeKeptGivenIndexHalf " << endl;
-    assert(this->indexOfContentToBeKept.size() == 0);
-    indexOfContentToBeKept = vector <size_t> (givenIndex.begin(),
-                                              givenIndex.end());
-    // assert(this->indexOfPosToBeKept.size() == 0);
-    vector <string> oldChrom = vector <string> (chrom_.begin(), chrom_.end());
-    this->chrom_.clear();
+size_t VariantIndex::findChrom(const string & chrom) const {
+    // Names that were never interned are on no chromosome list
+    ChromId id;
+    if (!ChromDictionary::global().find(chrom, &id)) {
+        return this->chromId_.size();
+    }
+    return this->findChrom(id);
+}
 
-    vector < vector < int > > oldposition = this->position_;
-    this->position_.clear();
 
-    for (size_t chromI = 0; chromI < oldChrom.size(); chromI++) {
-        // if (chromI%2 == 0) {
-        if (chromI > 10) {
-            dout << "   Going through chrom "<< oldChrom[chromI] << " ";
-            size_t hapIndex = indexOfChromStarts_[chromI];
-            vector <int> newTrimmedPos;
-            for (size_t posI = 0; posI < oldposition[chromI].size(); posI++) {
-                if (std::find(givenIndex.begin(), givenIndex.end(), hapIndex)
-                        != givenIndex.end()) {
-                    if (newTrimmedPos.size() == 0) {
-                        this->chrom_.push_back(oldChrom[chromI]);
-                    }
-                    newTrimmedPos.push_back(oldposition[chromI][posI]);
-                }
-                hapIndex++;
-            }
-            // std::cout << newTrimmedPos.size () << endl;
-            this->position_.push_back(newTrimmedPos);
-        }
+size_t VariantIndex::locate(const string & chrom, const int pos) const {
+    size_t chromI = this->findChrom(chrom);
+    if (chromI >= this->chromId_.size()) {
+        return npos;
     }
+    return this->locate(this->chromId_[chromI], pos);
+}
 
-    // assert(indexOfPosToBeKept.size() == this->chrom_.size());
 
-    dout << indexOfContentToBeKept.size() << " sites need to be Kept, with "
-         << this->chrom_.size() << endl;
+size_t VariantIndex::locate(const ChromId chromId, const int pos) const {
+    size_t chromI = this->findChrom(chromId);
+    if (chromI >= this->chromId_.size()) {
+        return npos;
+    }
+    Span <int> positions = this->position_[chromI];
+    const int * it = std::lower_bound(positions.begin(), positions.end(), pos);
+    if (it == positions.end() || *it != pos) {
+        return npos;
+    }
+    return this->siteIndex(chromI, it - positions.begin());
 }
 
 
-void VariantIndex::removePositions() {
-    assert(this->keptPosition_.size() == (size_t)0);
-    for (size_t chromI = 0; chromI < this->chrom_.size(); chromI++) {
-        vector <int> tmpKeptPosition_;
-        for (size_t i = 0; i < this->indexOfPosToBeKept[chromI].size(); i++) {
-            tmpKeptPosition_.push_back(
-                this->position_[chromI][this->indexOfPosToBeKept[chromI][i]]);
+SiteRange VariantIndex::range(const string & chrom, const int start,
+                              const int end) const {
+    size_t chromI = this->findChrom(chrom);
+    if (chromI >= this->chromId_.size()) {
+        SiteRange nothing = {0, 0};
+        return nothing;
+    }
+    return this->range(this->chromId_[chromI], start, end);
+}
+
+
+SiteRange VariantIndex::range(const ChromId chromId, const int start,
+                              const int end) const {
+    SiteRange sites = {0, 0};
+    size_t chromI = this->findChrom(chromId);
+    if (chromI >= this->chromId_.size() || end < start) {
+        return sites;
+    }
+    Span <int> positions = this->position_[chromI];
+    const int * first = std::lower_bound(positions.begin(), positions.end(),
+                                         start);
+    const int * last = std::upper_bound(first, positions.end(), end);
+    sites.begin = this->siteIndex(chromI, first - positions.begin());
+    sites.end = this->siteIndex(chromI, last - positions.begin());
+    return sites;
+}
+
+
+vector <size_t> VariantIndex::locate(
+        const string & chrom, const vector <int> & sortedPositions) const {
+    size_t chromI = this->findChrom(chrom);
+    if (chromI >= this->chromId_.size()) {
+        return vector <size_t>(sortedPositions.size(), npos);
+    }
+    return this->locate(this->chromId_[chromI], sortedPositions);
+}
+
+
+vector <size_t> VariantIndex::locate(
+        const ChromId chromId, const vector <int> & sortedPositions) const {
+    vector <size_t> sites(sortedPositions.size(), npos);
+    size_t chromI = this->findChrom(chromId);
+    if (chromI >= this->chromId_.size()) {
+        return sites;
+    }
+    Span <int> positions = this->position_[chromI];
+    const int * it = positions.begin();
+    for (size_t i = 0; i < sortedPositions.size(); i++) {
+        assert(i == 0 || sortedPositions[i-1] <= sortedPositions[i]);
+        it = std::lower_bound(it, positions.end(), sortedPositions[i]);
+        if (it == positions.end()) {
+            break;
+        }
+        if (*it == sortedPositions[i]) {
+            sites[i] = this->siteIndex(chromI, it - positions.begin());
         }
-        this->keptPosition_.push_back(tmpKeptPosition_);
     }
-    this->position_.clear();
-    this->position_ = this->keptPosition_;
-    this->keptPosition_.clear();
+    return sites;
+}
+
+
+void VariantIndex::appendSite(const ChromId chromId, const int pos,
+                              const string & fileName) {
+    if (this->chromId_.empty() || chromId != this->chromId_.back()) {
+        this->addChrom(chromId);
+        this->position_.newRow();
+    }
+    int previousPosition = this->position_.back().empty() ?
+                           0 : this->position_.back().back();
+    if (pos < previousPosition) {
+        throw PositionUnsorted(fileName);
+    }
+    this->position_.append(pos);
+}
+
+
+void VariantIndex::removePositions() {
+    this->position_.keepInPlace(this->indexOfPosToBeKept,
+                                &ThreadPool::shared());
 }
 
 
 void VariantIndex::getIndexOfChromStarts() {
     assert(this->doneGetIndexOfChromStarts_ == false);
-    this->indexOfChromStarts_.clear();
-    assert(indexOfChromStarts_.size() == 0);
-    this->indexOfChromStarts_.push_back((size_t)0);
-    for (size_t tmpChrom = 0;
-            indexOfChromStarts_.size() < this->chrom_.size(); tmpChrom++ ) {
-        indexOfChromStarts_.push_back(
-            indexOfChromStarts_.back()+this->position_[tmpChrom].size());
-    }
+    assert(this->position_.size() >= this->chrom_.size());
+    // The chromosome starts are the offsets of the position CSR
+    this->indexOfChromStarts_.assign(
+        this->position_.offsets().begin(),
+        this->position_.offsets().begin() + this->chrom_.size());
     assert(indexOfChromStarts_.size() == this->chrom_.size());
     this->setDoneGetIndexOfChromStarts(true);
 }
 
 
 void VariantIndex::getIndexOfChromStartsHalf() {
-    assert(this->doneGetIndexOfChromStarts_ == false);
-    this->indexOfChromStarts_.clear();
-    assert(indexOfChromStarts_.size() == 0);
-    this->indexOfChromStarts_.push_back((size_t)0);
-    for (size_t tmpChrom = 0;
-            indexOfChromStarts_.size() < this->chrom_.size(); tmpChrom++ ) {
-            indexOfChromStarts_.push_back(
-                indexOfChromStarts_.back()+this->position_[tmpChrom].size());
-    }
-    assert(indexOfChromStarts_.size() == this->chrom_.size());
-    this->setDoneGetIndexOfChromStarts(true);
+    // The starts come from the positions, whatever chromosomes are left
+    this->getIndexOfChromStarts();
 }
 
 
@@ -218,11 +299,23 @@ void VariantIndex::init() {
 }
 
 
+void VariantIndex::resetIndex() {
+    this->nLoci_ = 0;
+    this->clearChrom();
+    this->position_.clear();
+    this->indexOfChromStarts_.clear();
+    this->indexOfContentToBeKept.clear();
+    this->indexOfPosToBeKept.clear();
+    this->setDoneGetIndexOfChromStarts(false);
+}
+
+
 void VariantIndex::removeMarkers() { throw VirtualFunctionShouldNotBeCalled();}
 
 
 void VariantIndex::checkSortedPositions(string fileName) {
-    for (size_t chromI = 0; chromI < this->chrom_.size(); chromI++) {
+    // The exception of the first unsorted chromosome is the one thrown
+    ThreadPool::shared().parallelFor(this->chrom_.size(), [&](size_t chromI) {
         int previousPosition_ = 0;
         for (auto const &value : this->position_[chromI]) {
             if (value < previousPosition_) {
@@ -230,5 +323,5 @@ void VariantIndex::checkSortedPositions(string fileName) {
             }
             previousPosition_ = value;
         }
-    }
+    });
 }
@@ -27,44 +27,81 @@
 #define DEPLOID_SRC_VARIANTINDEX_HPP_
 
 
+#include <algorithm>  // std::min
 #include <vector>
 #include <string>
 #include <cassert>
+#include <utility>  // std::move
+#include "chromDictionary.hpp"
+#include "csr.hpp"
+#include "exceptions.hpp"
 #include "global.hpp"
+#include "threadPool.hpp"
 
 
 using std::vector;
 using std::string;
 
 class ExcludeMarker;
+class ChromSubset;
+
+/*! Sites [begin, end) in the global site index, i.e. the rows of the reader */
+struct SiteRange {
+    size_t begin;
+    size_t end;
+    size_t size() const { return this->end - this->begin; }
+    bool empty() const { return this->begin == this->end; }
+};
+
 
 class VariantIndex {
     #ifdef UNITTEST
     friend class TestPanel;
     friend class TestTxtReader;
     friend class TestInitialHaplotypes;
+    friend class TestSiteAligner;
+    friend class TestChromDictionary;
+    friend class TestVCF;
+    friend class TestCountIndex;
+    friend class TestChromSubset;
+    friend class TestThreadPool;
+    friend class TestInputLoader;
+    friend class TestVcfBatch;
+    friend class TestInputSource;
+    friend class TestLineIndex;
+    friend class TestGzIndex;
     #endif
     friend class DEploidIO;
     friend class TxtReader;
+    friend class BinaryPanel;
+    friend class SiteAligner;
+    friend class CountIndex;
+    friend class VcfBatch;
+    friend class ChromSubset;
     friend class ExcludeMarker;
     friend class Panel;
     friend class IBDrecombProbs;
     friend class VcfReader;
     friend class Rvcf;
+    friend class DvcfAccess;
 
  private:
     // Members
     size_t nLoci_;
     bool doneGetIndexOfChromStarts_;
     vector <string> chrom_;
+    /* Interned ids of this->chrom_, chromosomes are compared by id */
+    vector <ChromId> chromId_;
     vector < size_t > indexOfChromStarts_;
-    vector < vector < int> > position_;
-    vector < vector < int> > keptPosition_;
+    /* Positions of all sites in one array, row chromI of the CSR holds the
+     * positions of this->chrom_[chromI], and the CSR offsets are the index of
+     * the chromosome starts */
+    Csr < int > position_;
     /* Index of content/info will be kept */
     vector < size_t > indexOfContentToBeKept;
     /* Index of positions entry to be kept,
-     * this will have the same size as this->chrom_, */
-    vector < vector < size_t > > indexOfPosToBeKept;
+     * this will have the same number of rows as this->chrom_, */
+    Csr < size_t > indexOfPosToBeKept;
 
     // Getter and Setter
     bool doneGetIndexOfChromStarts() const {
@@ -74,6 +111,28 @@ class VariantIndex {
 
     // Methods
     void init();
+    /* Forget the sites of the last file, keeping the allocated capacity */
+    void resetIndex();
+    // Chromosome list, keeps chrom_ and chromId_ in step
+    void clearChrom() {
+        this->chrom_.clear();
+        this->chromId_.clear(); }
+    void addChrom(const ChromId id) {
+        this->chromId_.push_back(id);
+        this->chrom_.push_back(chromName(id)); }
+    void addChrom(const string & name) {
+        this->addChrom(ChromDictionary::global().intern(name)); }
+    /* Index of the chromosome in this->chrom_, or this->chrom_.size() if it
+     * is not here */
+    size_t findChrom(const ChromId id) const;
+    size_t findChrom(const string & chrom) const;
+    static const string & chromName(const ChromId id) {
+        return ChromDictionary::global().name(id); }
+    /* Add the next site of the file to the chromosomes and positions, a new
+     * chromosome starts whenever the id differs from the previous site.
+     * Sortedness is checked on the way, as in checkSortedPositions(). */
+    void appendSite(const ChromId chromId, const int pos,
+                    const string & fileName);
     void getIndexOfChromStarts();
     void getIndexOfChromStartsHalf();
     void removePositions();
@@ -81,14 +140,118 @@ class VariantIndex {
     void findAndKeepMarkers(ExcludeMarker* excludedMarkers);
     virtual void removeMarkers();
     // For removing markers and positions
+    template <class T>
+    static void keepRowsInPlace(vector <T> * rows,
+                                const vector <size_t> & indexToBeKept);
     void findWhoToBeKept(ExcludeMarker* excludedMarkers);
     void findWhoToBeKeptGivenIndex(const vector <size_t> & givenIndex);
     void findWhoToBeKeptGivenIndexHalf(const vector <size_t> & givenIndex);
+    /* Keep the given sites that are on the chromosomes of the subset, the
+     * given sites must be in increasing order */
+    void findWhoToBeKeptGivenIndex(const vector <size_t> & givenIndex,
+                                   const ChromSubset & subset);
 
  public:
     VariantIndex();
     virtual ~VariantIndex() {}
+
+    // Conversion between the global site index and (chrom, position index)
+    size_t chromIndexOfSite(const size_t siteI) const {
+        return this->position_.rowOf(siteI); }
+    size_t siteIndex(const size_t chromI, const size_t posI) const {
+        return this->position_.flatIndex(chromI, posI); }
+    size_t nSites() const { return this->position_.nValues(); }
+
+    // Queries, binary searches over the sorted positions of a chromosome
+    static const size_t npos;
+    /*! Site index of chrom:pos, or npos if there is no such site. With
+     *  repeated positions this is the first of them. */
+    size_t locate(const string & chrom, const int pos) const;
+    size_t locate(const ChromId chromId, const int pos) const;
+    /*! Sites of chrom with start <= position <= end, empty if there are none
+     *  or the chromosome is not here. */
+    SiteRange range(const string & chrom, const int start,
+                    const int end) const;
+    SiteRange range(const ChromId chromId, const int start,
+                    const int end) const;
+    /*! locate() of each position in a list sorted in increasing order, each
+     *  search starts where the previous one stopped. */
+    vector <size_t> locate(const string & chrom,
+                           const vector <int> & sortedPositions) const;
+    vector <size_t> locate(const ChromId chromId,
+                           const vector <int> & sortedPositions) const;
 };
 
 
+/*! rows[i] = rows[indexToBeKept[i]], throws OutOfVectorSize if an index is
+ *  past the end of the rows. A strictly increasing index is compacted in
+ *  place, so no second copy of the data is made. Any other index, e.g. one
+ *  that puts the rows into the chromosome order of another input, is
+ *  gathered into a new vector.
+ *
+ *  The index is cut into one block per thread of the shared pool. The rows of
+ *  a block lie between its first and last index, apart from the rows of the
+ *  other blocks, so all blocks are compacted to the front of their own range
+ *  at the same time. The blocks are then moved down into place in order. The
+ *  first block is compacted straight into place, so with one thread this is
+ *  a single pass.
+ */
+template <class T>
+void VariantIndex::keepRowsInPlace(vector <T> * rows,
+                                   const vector <size_t> & indexToBeKept) {
+    size_t nKept = indexToBeKept.size();
+    bool increasing = true;
+    bool repeated = false;
+    vector <bool> taken(rows->size(), false);
+    for (size_t i = 0; i < nKept; i++) {
+        size_t from = indexToBeKept[i];
+        if (from >= rows->size()) {
+            throw OutOfVectorSize();
+        }
+        if (i > 0 && from <= indexToBeKept[i - 1]) {
+            increasing = false;
+        }
+        repeated = repeated || taken[from];
+        taken[from] = true;
+    }
+    if (!increasing) {
+        // A row that is kept twice is copied, otherwise rows are moved
+        vector <T> kept;
+        kept.reserve(nKept);
+        for (auto const &from : indexToBeKept) {
+            if (repeated) {
+                kept.push_back((*rows)[from]);
+            } else {
+                kept.push_back(std::move((*rows)[from]));
+            }
+        }
+        rows->swap(kept);
+        return;
+    }
+
+    size_t nBlocks = std::min(nKept, ThreadPool::shared().nThreads());
+    ThreadPool::shared().parallelFor(nBlocks, [&](size_t block) {
+        size_t first = block * nKept / nBlocks;
+        size_t last = (block + 1) * nKept / nBlocks;
+        size_t to = (block == 0) ? 0 : indexToBeKept[first];
+        for (size_t i = first; i < last; i++) {
+            size_t from = indexToBeKept[i];
+            if (from != to) {
+                (*rows)[to] = std::move((*rows)[from]);
+            }
+            to++;
+        }
+    });
+    for (size_t block = 1; block < nBlocks; block++) {
+        size_t first = block * nKept / nBlocks;
+        size_t last = (block + 1) * nKept / nBlocks;
+        size_t from = indexToBeKept[first];
+        for (size_t i = first; i < last && from != first; i++) {
+            (*rows)[i] = std::move((*rows)[from + i - first]);
+        }
+    }
+    rows->erase(rows->begin() + nKept, rows->end());
+}
+
+
 #endif  // DEPLOID_SRC_VARIANTINDEX_HPP_
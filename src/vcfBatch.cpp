@@ -0,0 +1,141 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>  // min
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include "exceptions.hpp"
+#include "threadPool.hpp"
+#include "vcfBatch.hpp"
+
+using std::endl;
+
+
+void VcfBatch::add(const string & fileName, const string & sampleName) {
+    this->fileNames_.push_back(fileName);
+    this->sampleNames_.push_back(sampleName);
+}
+
+
+void VcfBatch::load() {
+    size_t nFiles = this->nSamples();
+    this->refCount_.assign(nFiles, vector <int>());
+    this->altCount_.assign(nFiles, vector <int>());
+    this->contigLines_.clear();
+    this->chromId_.clear();
+    this->position_.clear();
+    if (nFiles == 0) {
+        return;
+    }
+
+    // The first file sets the contigs and sites the others are checked on
+    VcfReader firstReader;
+    this->loadSample(0, &firstReader);
+
+    // Each slot holds at most one open file, and takes the next file when it
+    // is done with it. Files are taken in order, so every file before a
+    // failing one is read and the first failing file is known at the end.
+    size_t nSlots = std::min(std::min(this->maxOpenFiles_, nFiles - 1),
+                             ThreadPool::shared().nThreads());
+    std::atomic <size_t> nextFile(1);
+    std::atomic <bool> failed(false);
+    vector <std::exception_ptr> errors(nFiles);
+    ThreadPool::shared().parallelFor(nSlots, [&](size_t) {
+        // Every file has the sites of the first one
+        VcfReader reader;
+        reader.setSizeHint(this->nSites());
+        while (!failed) {
+            size_t sampleI = nextFile++;
+            if (sampleI >= nFiles) {
+                return;
+            }
+            try {
+                this->loadSample(sampleI, &reader);
+            } catch (...) {
+                errors[sampleI] = std::current_exception();
+                failed = true;
+            }
+        }
+    });
+    for (auto const &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    dout << " Loaded " << nFiles << " samples at " << this->nSites()
+         << " sites" << endl;
+}
+
+
+void VcfBatch::loadSample(const size_t sampleI, VcfReader * reader) {
+    const string & fileName = this->fileNames_[sampleI];
+    reader->open(fileName, this->sampleNames_[sampleI]);
+
+    if (sampleI == 0) {
+        this->contigLines_ = findContigLines(*reader);
+        this->chromId_ = reader->chromId_;
+        this->position_ = reader->position_;
+    } else {
+        // Only read here, the first file is done before any other starts
+        if (findContigLines(*reader) != this->contigLines_) {
+            throw ContigMismatch(fileName, this->fileNames_[0]);
+        }
+        if (reader->chromId_ != this->chromId_ ||
+                reader->position_.values() != this->position_.values() ||
+                reader->position_.offsets() != this->position_.offsets()) {
+            throw LociNumberUnequal(fileName);
+        }
+    }
+
+    Span <int32_t> ref = reader->refCountColumn().raw();
+    Span <int32_t> alt = reader->altCountColumn().raw();
+    this->refCount_[sampleI].assign(ref.begin(), ref.end());
+    this->altCount_[sampleI].assign(alt.begin(), alt.end());
+}
+
+
+vector <int> VcfBatch::stack(const vector < vector <int> > & columns) const {
+    size_t nSamples = columns.size();
+    vector <int> matrix(this->nSites() * nSamples);
+    for (size_t sampleI = 0; sampleI < nSamples; sampleI++) {
+        const vector <int> & column = columns[sampleI];
+        for (size_t siteI = 0; siteI < column.size(); siteI++) {
+            matrix[siteI * nSamples + sampleI] = column[siteI];
+        }
+    }
+    return matrix;
+}
+
+
+vector <string> VcfBatch::findContigLines(const VcfReader & reader) {
+    vector <string> contigLines;
+    for (auto const &line : reader.headerLines) {
+        if (line.compare(0, 9, "##contig=") == 0) {
+            contigLines.push_back(line);
+        }
+    }
+    return contigLines;
+}
@@ -0,0 +1,109 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_VCFBATCH_HPP_
+#define DEPLOID_SRC_VCFBATCH_HPP_
+
+#include <string>
+#include <vector>
+#include "vcfReader.hpp"
+
+using std::string;
+using std::vector;
+
+/*! \brief Loads the counts of many single sample VCFs of one cohort
+ *
+ *  The files are read as tasks on the shared thread pool, with at most
+ *  maxOpenFiles() of them open at a time. All files must have the contig
+ *  header lines and the sites of the first file: the first file is read on
+ *  its own, and every other file is checked against it as it is read, so a
+ *  mismatch throws ContigMismatch or LociNumberUnequal naming that file.
+ *  If several files fail, the exception of the first of them is rethrown.
+ *
+ *  Only the sites and the allele counts are kept. Each slot reads all its
+ *  files with one reader, which keeps its buffers from file to file. The
+ *  counts come back either as one column per sample, or stacked into one
+ *  sites by samples matrix.
+ */
+class VcfBatch {
+#ifdef UNITTEST
+    friend class TestVcfBatch;
+#endif
+ public:
+    VcfBatch() : maxOpenFiles_(64) {}
+    ~VcfBatch() {}
+
+    void add(const string & fileName, const string & sampleName);
+    /* Upper bound on the VCFs open at the same time, at least one */
+    void setMaxOpenFiles(const size_t maxOpenFiles) {
+        this->maxOpenFiles_ = (maxOpenFiles > 0) ? maxOpenFiles : 1; }
+    size_t maxOpenFiles() const { return this->maxOpenFiles_; }
+    void load();
+
+    size_t nSamples() const { return this->fileNames_.size(); }
+    const string & fileName(size_t sampleI) const {
+        return this->fileNames_[sampleI]; }
+    const string & sampleName(size_t sampleI) const {
+        return this->sampleNames_[sampleI]; }
+
+    // Sites shared by all files, taken from the first file
+    size_t nSites() const { return this->position_.nValues(); }
+    const vector <ChromId> & chromId() const { return this->chromId_; }
+    const Csr <int> & position() const { return this->position_; }
+    const vector <string> & contigLines() const { return this->contigLines_; }
+
+    // Per sample columns, one count per site
+    const vector <int> & refCount(size_t sampleI) const {
+        return this->refCount_[sampleI]; }
+    const vector <int> & altCount(size_t sampleI) const {
+        return this->altCount_[sampleI]; }
+
+    /* Counts of all samples in one row major matrix, the count of site siteI
+     * in sample sampleI is at [siteI * nSamples() + sampleI] */
+    vector <int> stackedRefCount() const {
+        return this->stack(this->refCount_); }
+    vector <int> stackedAltCount() const {
+        return this->stack(this->altCount_); }
+
+ private:
+    VcfBatch(const VcfBatch &);
+    VcfBatch & operator=(const VcfBatch &);
+
+    size_t maxOpenFiles_;
+    vector <string> fileNames_;
+    vector <string> sampleNames_;
+
+    vector <string> contigLines_;
+    vector <ChromId> chromId_;
+    Csr <int> position_;
+    vector < vector <int> > refCount_;
+    vector < vector <int> > altCount_;
+
+    void loadSample(const size_t sampleI, VcfReader * reader);
+    vector <int> stack(const vector < vector <int> > & columns) const;
+    static vector <string> findContigLines(const VcfReader & reader);
+};
+
+#endif  // DEPLOID_SRC_VCFBATCH_HPP_
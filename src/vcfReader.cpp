@@ -23,106 +23,328 @@
  *
  */
 
-#include <algorithm>     // std::min
+#include <errno.h>       // errno, ERANGE
+#include <sys/stat.h>    // stat
+#include <zlib.h>        // crc32
+#include <algorithm>     // std::min, std::find
 #include <cassert>       // assert
+#include <stdexcept>     // std::invalid_argument, std::out_of_range
 #include <iostream>      // std::cout
+#include "rowEstimate.hpp"
 #include "vcfReader.hpp"
 #include "global.hpp"
 
 // using namespace std;
 using std::min;
 
+
+namespace {
+
+// Data bytes after the header that are checksummed for refresh()
+const uint64_t prefixBytes = 1 << 16;
+// Bytes searched back for the start of a last line without a newline
+const uint64_t tailBytes = 1 << 16;
+
+
+uint32_t crcOf(const char * data, size_t size) {
+    return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0),
+        reinterpret_cast<const Bytef *>(data), size));
+}
+
+}  // namespace
+
+
+/*! Empty reader, open() reads a file into it */
+VcfReader::VcfReader() {
+    this->sampleColumnIndex_ = 0;
+    this->extractPlaf_ = false;
+    this->sizeHint_ = 0;
+    this->useLineIndex_ = false;
+    this->isFile_ = false;
+    this->completeLinesOnly_ = false;
+    this->consumed_ = 0;
+    this->resetIndex();
+}
+
+
 /*! Initialize vcf file, search for the end of the vcf header.
  *  Extract the first block of data ( "buffer_length" lines ) into buff
  */
 VcfReader::VcfReader(string fileName, string sampleName, bool extractPlaf) {
+    this->sizeHint_ = 0;
+    this->useLineIndex_ = false;
+    this->open(fileName, sampleName, extractPlaf);
+}
+
+
+VcfReader::VcfReader(const InputSource & source, string sampleName,
+                     bool extractPlaf) {
+    this->sizeHint_ = 0;
+    this->useLineIndex_ = false;
+    this->open(source, sampleName, extractPlaf);
+}
+
+
+void VcfReader::open(string fileName, string sampleName, bool extractPlaf) {
+    this->open(InputSource::fromName(fileName), sampleName, extractPlaf);
+}
+
+
+void VcfReader::open(const InputSource & source, string sampleName,
+                     bool extractPlaf) {
+    this->reset();
     /*! Initialize by read in the vcf header file */
-    this->init(fileName);
+    this->init(source);
     this->sampleName_ = sampleName;
     this->extractPlaf_ = extractPlaf;
     this->sampleColumnIndex_ = 0;
     this->readHeader();
-    this->readVariants();
-    this->getChromList();
+    this->isFile_ = source.isPath();
+    // Only a plain file can be read on from a byte offset
+    bool plainFile = source.isPath() && !this->isCompressed();
+    // A last line of a file without its newline may still be being written,
+    // it is left to refresh()
+    this->completeLinesOnly_ = plainFile;
+    uint64_t headerSize = this->consumed_;
+    // After the header, so that the contig lines set the order of the ids
+    this->chromosomeIds_.clear();
+    for (auto const &chrom : this->chromosomes_) {
+        this->chromosomeIds_.push_back(ChromDictionary::global().intern(chrom));
+    }
+
+    LineIndex index;
+    GzIndex gzIndex;
+    bool indexed = false;
+    if (this->useLineIndex_ && source.isPath()) {
+        indexed = this->isCompressed() ?
+                  gzIndex.loadOrBuild(this->fileName_, 0, &index) :
+                  index.loadOrBuild(this->fileName_);
+    }
+    vector <LineRange> ranges;
+    if (indexed) {
+        ranges = index.select([this](const string & chrom) {
+            return this->isWanted(chrom); });
+    }
+    // Reserved up front, so that the columns do not move as they grow. Only
+    // a file can be sampled for an estimate, a pipe is read once.
+    size_t nSites = this->sizeHint_;
+    if (indexed) {
+        nSites = 0;
+        for (auto const &range : ranges) {
+            nSites += range.nLines;
+        }
+    } else if (nSites == 0 && source.isPath()) {
+        nSites = RowEstimate::ofFile(this->fileName_).reserveSize();
+    }
+    this->refColumn_.reserve(nSites);
+    this->altColumn_.reserve(nSites);
+    this->vqslodColumn_.reserve(nSites);
+    this->plafColumn_.reserve(nSites);
+    this->position_.reserve(0, nSites);
+    // The chromosomes, positions and sortedness are done line by line
+    if (indexed) {
+        this->readVariants(ranges, this->isCompressed() ? &gzIndex : NULL);
+    } else {
+        this->readVariants();
+    }
+    this->nLoci_ = this->refColumn_.size();
     this->getIndexOfChromStarts();
     assert(this->doneGetIndexOfChromStarts_ == true);
-    this->checkSortedPositions(fileName);
+    if (plainFile) {
+        this->setCheckpoint(headerSize,
+                            indexed ? index.dataEnd() : this->consumed_);
+    }
 }
 
 
-void VcfReader::checkFileCompressed() {
-    FILE *f = NULL;
-    f = fopen(this->fileName_.c_str(), "rb");
-    if (f == NULL) {
-        throw InvalidInputFile(this->fileName_);
+void VcfReader::reset() {
+    // Closed and cleared, a stream at the end of the last file is not good()
+    this->in_.close();
+    this->isFile_ = false;
+    this->completeLinesOnly_ = false;
+    this->checkpoint_ = VcfCheckpoint();
+
+    this->headerLines.clear();
+    this->refCount.clear();
+    this->altCount.clear();
+    this->vqslod.clear();
+    this->plaf.clear();
+    this->refColumn_.clear();
+    this->altColumn_.clear();
+    this->vqslodColumn_.clear();
+    this->plafColumn_.clear();
+    this->legitVqslodAt.clear();
+    this->resetIndex();
+}
+
+
+void VcfReader::init(const InputSource & source) {
+    /*! Initialize other VcfReader class members
+     */
+    this->fileName_ = source.name();
+    this->consumed_ = 0;
+    // Compression is found from the first bytes, on the same handle
+    this->in_.open(source);
+    dout << "Check if vcf is compressed " << this->isCompressed() << std::endl;
+}
+
+
+void VcfReader::finalize() {
+    // The double vectors are made on request, from the compact columns
+    this->refCount = this->refCountColumn().toVector();
+    this->altCount = this->altCountColumn().toVector();
+    this->vqslod = this->vqslodColumn().toVector();
+    this->plaf = this->plafColumn().toVector();
+
+    this->in_.close();
+}
+
+
+bool VcfReader::nextLine() {
+    // A failed getline() leaves the last line in place
+    if (!getline(this->in_, this->tmpLine_)) {
+        this->tmpLine_.clear();
+        return false;
     }
+    // A line that ends the input has no newline
+    this->consumed_ += this->tmpLine_.size() + (this->in_.eof() ? 0 : 1);
+    return true;
+}
 
-    unsigned char magic[2];
 
-    size_t freadResults = fread(reinterpret_cast<void *>(magic), 1, 2, f);
-    dout << "Check if vcf is compressed " << freadResults << std::endl;
-    this->setIsCompressed((static_cast<int>(magic[0]) == 0x1f) &&
-                              (static_cast<int>(magic[1]) == 0x8b));
-    fclose(f);
+/*! Where refresh() reads on, after a file was read up to dataEnd. A last
+ *  line without its newline was not read, so the offset is at its start. */
+void VcfReader::setCheckpoint(const uint64_t headerSize,
+                              const uint64_t dataEnd) {
+    VcfCheckpoint & checkpoint = this->checkpoint_;
+    checkpoint = VcfCheckpoint();
+    checkpoint.headerSize = headerSize;
+    checkpoint.offset = dataEnd;
+    try {
+        if (dataEnd > headerSize) {
+            uint64_t tailBegin = std::max(headerSize,
+                                          dataEnd - std::min(dataEnd,
+                                                             tailBytes));
+            string tail;
+            LineIndex::readRange(this->fileName_, tailBegin, dataEnd, &tail);
+            if (tail.back() != '\n') {
+                size_t lineStart = tail.rfind('\n');
+                if (lineStart == string::npos && tailBegin > headerSize) {
+                    // No line start in reach, refresh() reads the file again
+                    return;
+                }
+                lineStart = (lineStart == string::npos) ? 0 : lineStart + 1;
+                checkpoint.offset = tailBegin + lineStart;
+            }
+        }
+        this->updateCheckpoint();
+    } catch (const InvalidInputFile &) {
+        return;
+    }
+    checkpoint.valid = true;
 }
 
-void VcfReader::init(string fileName) {
-    /*! Initialize other VcfReader class members
-     */
-    this->fileName_ = fileName;
 
-    this->checkFileCompressed();
+/*! The checksums and the last site, after the offset moved */
+void VcfReader::updateCheckpoint() {
+    VcfCheckpoint & checkpoint = this->checkpoint_;
+    checkpoint.prefixEnd = std::min(checkpoint.offset,
+                                    checkpoint.headerSize + prefixBytes);
+    string bytes;
+    LineIndex::readRange(this->fileName_, 0, checkpoint.prefixEnd, &bytes);
+    checkpoint.headerCrc = crcOf(bytes.data(), checkpoint.headerSize);
+    checkpoint.prefixCrc = crcOf(bytes.data() + checkpoint.headerSize,
+                                 bytes.size() - checkpoint.headerSize);
+    if (!this->chromId_.empty() && !this->position_.back().empty()) {
+        checkpoint.lastChrom = VariantIndex::chromName(this->chromId_.back());
+        checkpoint.lastPos = this->position_.back().back();
+    }
+}
 
-    if ( this->isCompressed() ) {
-        this->inFileGz.open(this->fileName_.c_str(), std::ios::in);
-    } else {
-        this->inFile.open(this->fileName_.c_str(), std::ios::in);
+
+/*! False if the file is shorter than what was read, or its header or the
+ *  start of its data changed */
+bool VcfReader::sameFile(uint64_t * fileSize) const {
+    const VcfCheckpoint & checkpoint = this->checkpoint_;
+    struct stat fileStat;
+    if (stat(this->fileName_.c_str(), &fileStat) != 0) {
+        return false;
+    }
+    *fileSize = static_cast<uint64_t>(fileStat.st_size);
+    if (*fileSize < checkpoint.offset) {
+        return false;
     }
+    string bytes;
+    try {
+        LineIndex::readRange(this->fileName_, 0, checkpoint.prefixEnd,
+                             &bytes);
+    } catch (const InvalidInputFile &) {
+        return false;
+    }
+    return crcOf(bytes.data(), checkpoint.headerSize) ==
+               checkpoint.headerCrc &&
+           crcOf(bytes.data() + checkpoint.headerSize,
+                 bytes.size() - checkpoint.headerSize) ==
+               checkpoint.prefixCrc;
 }
 
 
-void VcfReader::finalize() {
-    for (size_t i = 0; i < this->variants.size(); i++) {
-        this->refCount.push_back(static_cast<double>(this->variants[i].ref));
-        this->altCount.push_back(static_cast<double>(this->variants[i].alt));
-        this->vqslod.push_back(this->variants[i].vqslod);
-        this->plaf.push_back(this->variants[i].plaf);
+VcfRefresh VcfReader::refresh() {
+    if (!this->isFile_) {
+        return VCF_UNCHANGED;
+    }
+    VcfCheckpoint & checkpoint = this->checkpoint_;
+    string bytes;
+    uint64_t fileSize = 0;
+    bool reload = !checkpoint.valid || !this->sameFile(&fileSize);
+    if (!reload) {
+        LineIndex::readRange(this->fileName_, checkpoint.offset, fileSize,
+                             &bytes);
+    }
+    if (reload) {
+        dout << " " << this->fileName_ << " changed, read it again"
+             << std::endl;
+        this->open(this->fileName_, this->sampleName_, this->extractPlaf_);
+        return VCF_RELOADED;
     }
 
-    if ( this->isCompressed() ) {
-        this->inFileGz.close();
-    } else {
-        this->inFile.close();
+    // A line still being written is read at the next refresh()
+    size_t complete = bytes.rfind('\n');
+    if (complete == string::npos) {
+        return VCF_UNCHANGED;
     }
+    complete++;
+    size_t nSites = this->refColumn_.size();
+    this->in_.open(InputSource::memory(bytes.data(), complete,
+                                       this->fileName_));
+    this->readVariantLines();
+    this->in_.close();
+    checkpoint.offset += complete;
+    this->updateCheckpoint();
+
+    this->nLoci_ = this->refColumn_.size();
+    this->setDoneGetIndexOfChromStarts(false);
+    this->getIndexOfChromStarts();
+    dout << " Read " << this->nLoci_ - nSites << " new sites of "
+         << this->fileName_ << std::endl;
+    return (this->nLoci_ > nSites) ? VCF_APPENDED : VCF_UNCHANGED;
 }
 
 
 void VcfReader::readHeader() {
-    if (this->isCompressed()) {
-        if (!inFileGz.good()) {
-            throw InvalidInputFile(this->fileName_);
-        }
-    } else {
-        if (!inFile.good()) {
-            throw InvalidInputFile(this->fileName_);
-        }
+    if (!this->in_.good()) {
+        throw InvalidInputFile(this->fileName_);
     }
 
-    if (this->isCompressed()) {
-        getline(inFileGz, this->tmpLine_);
-    } else {
-        getline(inFile, this->tmpLine_);
-    }
+    this->nextLine();
 
     while (this->tmpLine_.size() > 0) {
         if (this->tmpLine_[0] == '#') {
             if (this->tmpLine_[1] == '#') {
                 this->headerLines.push_back(this->tmpLine_);
-                if (this->isCompressed()) {
-                    getline(inFileGz, this->tmpLine_);
-                } else {
-                    getline(inFile, this->tmpLine_);
-                }
+                // Chromosome ids follow the contig order of the header
+                ChromDictionary::global().internContigLine(this->tmpLine_);
+                this->nextLine();
             } else {
                 this->checkFeilds();
                 break;  // end of the header
@@ -186,115 +408,131 @@ void VcfReader::checkFeilds() {
 
 
 void VcfReader::readVariants() {
-    if (this->isCompressed()) {
-        getline(inFileGz, this->tmpLine_);
-    } else {
-        getline(inFile, this->tmpLine_);
-    }
-    while (inFile.good() && this->tmpLine_.size() > 0) {
-        VariantLine newVariant(this->tmpLine_, this->sampleColumnIndex_,
-            this->extractPlaf_);
-        // check variantLine quality
-        this->variants.push_back(newVariant);
-        if (this->isCompressed()) {
-            getline(inFileGz, this->tmpLine_);
+    this->clearChrom();
+    this->position_.clear();
+    this->readVariantLines();
+}
+
+
+void VcfReader::readVariants(const vector <LineRange> & ranges,
+                             const GzIndex * gz) {
+    this->clearChrom();
+    this->position_.clear();
+    // The ranges are whole lines, read one by one through the same stream
+    string bytes;
+    for (auto const &range : ranges) {
+        if (gz != NULL) {
+            gz->extract(this->fileName_, range.begin, range.end, &bytes);
         } else {
-            getline(inFile, this->tmpLine_);
+            LineIndex::readRange(this->fileName_, range.begin, range.end,
+                                 &bytes);
         }
+        this->in_.open(InputSource::memory(bytes.data(), bytes.size(),
+                                           this->fileName_));
+        this->readVariantLines();
     }
+    this->in_.close();
 }
 
 
-void VcfReader::getChromList() {
-    this->chrom_.clear();
-    this->position_.clear();
-
-    assert(this->chrom_.size() == (size_t)0);
-    assert(this->position_.size() == (size_t)0);
+bool VcfReader::isWanted(const string & chrom) const {
+    return this->chromosomes_.empty() ||
+           std::find(this->chromosomes_.begin(), this->chromosomes_.end(),
+                     chrom) != this->chromosomes_.end();
+}
 
-    string previousChrom("");
-    vector <int> positionOfChrom_;
 
-    for (size_t i = 0; i < this->variants.size() ; i++) {
-        if (previousChrom != this->variants[i].chromStr &&
-            previousChrom.size() > (size_t)0) {
-            this->chrom_.push_back(previousChrom);
-            this->position_.push_back(positionOfChrom_);
-            positionOfChrom_.clear();
+void VcfReader::readVariantLines() {
+    // A last line without a newline is read too, unless it may not be
+    // complete yet
+    while (this->nextLine() && this->tmpLine_.size() > 0) {
+        if (this->completeLinesOnly_ && this->in_.eof()) {
+            this->consumed_ -= this->tmpLine_.size();
+            break;
+        }
+        VariantLine & newVariant = this->variantLine_;
+        newVariant.parse(this->tmpLine_, this->sampleColumnIndex_,
+                         this->extractPlaf_);
+        if (!this->chromosomeIds_.empty() &&
+                std::find(this->chromosomeIds_.begin(),
+                          this->chromosomeIds_.end(), newVariant.chromId) ==
+                    this->chromosomeIds_.end()) {
+            continue;
         }
-        positionOfChrom_.push_back(
-            stoi(this->variants[i].posStr.c_str(), NULL));
-        previousChrom = this->variants[i].chromStr;
+        // check variantLine quality
+        this->appendSite(newVariant.chromId, newVariant.pos, this->fileName_);
+        this->refColumn_.push_back(newVariant.ref);
+        this->altColumn_.push_back(newVariant.alt);
+        this->vqslodColumn_.push_back(newVariant.vqslod);
+        this->plafColumn_.push_back(static_cast<float>(newVariant.plaf));
     }
-
-    this->chrom_.push_back(previousChrom);
-    this->position_.push_back(positionOfChrom_);
-    assert(this->position_.size() == this->chrom_.size());
 }
 
 
 void VcfReader::removeMarkers() {
-    assert(this->keptVariants.size() == (size_t)0);
-    for (auto const &value : this->indexOfContentToBeKept) {
-        this->keptVariants.push_back(this->variants[value]);
-    }
-    this->variants.clear();
-    this->variants = this->keptVariants;
-    this->keptVariants.clear();
-    this->nLoci_ = this->variants.size();
+    keepRowsInPlace(&this->refColumn_, this->indexOfContentToBeKept);
+    keepRowsInPlace(&this->altColumn_, this->indexOfContentToBeKept);
+    keepRowsInPlace(&this->vqslodColumn_, this->indexOfContentToBeKept);
+    keepRowsInPlace(&this->plafColumn_, this->indexOfContentToBeKept);
+    this->nLoci_ = this->refColumn_.size();
     dout << " Vcf number of loci kept = " << this->nLoci_ << std::endl;
 }
 
 
 void VcfReader::findLegitSnpsGivenVQSLOD(double vqslodThreshold) {
-    this->legitVqslodAt.clear();
-    assert(legitVqslodAt.size() == 0);
-    for (size_t i = 0; i < this->vqslod.size(); i++) {
-        if (this->vqslod[i] > vqslodThreshold) {
-            this->legitVqslodAt.push_back(i);
-        }
-    }
+    this->findLegitSnpsGivenVQSLOD(vqslodThreshold, ChromSubset::all(*this));
 }
 
 
 void VcfReader::findLegitSnpsGivenVQSLODHalf(double vqslodThreshold) {
+    // Only the chromosomes after the first eleven
+    this->findLegitSnpsGivenVQSLOD(vqslodThreshold,
+                                   ChromSubset::from(*this, 11));
+}
+
+
+void VcfReader::findLegitSnpsGivenVQSLOD(double vqslodThreshold,
+                                         const ChromSubset & subset) {
     this->legitVqslodAt.clear();
     assert(legitVqslodAt.size() == 0);
-
-    for (size_t chromI = 0;
-         chromI < this->indexOfChromStarts_.size(); chromI++) {
-        size_t start = this->indexOfChromStarts_[chromI];
-        size_t length = this->position_[chromI].size();
-        // if (chromI%2 == 0) {
-        if (chromI > 10) {
-            for ( size_t ii = start ; ii < (start+length); ii++ ) {
-                if (this->vqslod[ii] > vqslodThreshold) {
-                    // std::cout << ii <<std::std::endl;
-                    this->legitVqslodAt.push_back(ii);
-                }
+    // One task per chromosome, merged in chromosome order
+    vector < vector <size_t> > legit(subset.nChrom());
+    DoubleView <double> vqslod = this->vqslodColumn();
+    ThreadPool::shared().parallelFor(subset.nChrom(), [&](size_t i) {
+        for (size_t ii = subset.sites(i).begin; ii < subset.sites(i).end;
+             ii++) {
+            if (vqslod[ii] > vqslodThreshold) {
+                legit[i].push_back(ii);
             }
         }
+    });
+    for (auto const &chromLegit : legit) {
+        this->legitVqslodAt.insert(this->legitVqslodAt.end(),
+                                   chromLegit.begin(), chromLegit.end());
     }
 }
 
 
-VariantLine::VariantLine(string tmpLine, size_t sampleColumnIndex,
+VariantLine::VariantLine(const string & tmpLine, size_t sampleColumnIndex,
+    bool extractPlaf) {
+    this->parse(tmpLine, sampleColumnIndex, extractPlaf);
+}
+
+
+void VariantLine::parse(const string & tmpLine, size_t sampleColumnIndex,
     bool extractPlaf) {
     this->init(tmpLine, sampleColumnIndex, extractPlaf);
 
     while (fieldEnd_ < this->tmpLine_.size()) {
         fieldEnd_ = min(this->tmpLine_.find('\t', feildStart_),
                         this->tmpLine_.find('\n', feildStart_));
-        this->tmpStr_ = this->tmpLine_.substr(feildStart_,
-                                              fieldEnd_-feildStart_);
+        // Copied into the capacity tmpStr_ already has, not a new substring
+        this->tmpStr_.assign(this->tmpLine_, feildStart_,
+                             fieldEnd_-feildStart_);
         switch (fieldIndex_) {
             case 0: this->extract_field_CHROM();   break;
             case 1: this->extract_field_POS();    break;
-            case 2: this->extract_field_ID();     break;
-            case 3: this->extract_field_REF() ;   break;
-            case 4: this->extract_field_ALT() ;   break;
-            case 5: this->extract_field_QUAL() ;   break;
-            case 6: this->extract_field_FILTER();  break;
+            // ID, REF, ALT, QUAL and FILTER are not kept
             case 7: this->extract_field_INFO();    break;
             case 8: this->extract_field_FORMAT();  break;
         }
@@ -306,57 +544,67 @@ VariantLine::VariantLine(string tmpLine, size_t sampleColumnIndex,
         feildStart_ = fieldEnd_+1;
         fieldIndex_++;
     }
+    // A line cut short before POS has no site
+    if (this->fieldIndex_ < 2) {
+        throw VcfPositionNotFound(this->tmpLine_);
+    }
 }
 
 
-void VariantLine::init(string tmpLine, size_t sampleColumnIndex,
+void VariantLine::init(const string & tmpLine, size_t sampleColumnIndex,
     bool extractPlaf) {
     this->tmpLine_ = tmpLine;
     this->feildStart_ = 0;
     this->fieldEnd_ = 0;
     this->fieldIndex_  = 0;
     this->adFieldIndex_ = -1;
+    // A line cut short leaves the fields it does not reach at zero
+    this->chromId = 0;
+    this->pos = 0;
+    this->ref = 0;
+    this->alt = 0;
+    this->vqslod = 0.0;
+    // Only read from the INFO field if asked for
+    this->plaf = 0.0;
     this->sampleColumnIndex_ = sampleColumnIndex;
     this->extractPlaf_ = extractPlaf;
 }
 
 
 void VariantLine::extract_field_CHROM() {
-    this->chromStr = this->tmpStr_;
+    this->chromId = ChromDictionary::global().intern(this->tmpStr_);
 }
 
 
 void VariantLine::extract_field_POS() {
-    this->posStr = this->tmpStr_;
-}
-
-
-void VariantLine::extract_field_ID() {
-    this->idStr = this->tmpStr_;
-}
-
-
-void VariantLine::extract_field_REF() {
-    this->refStr = this->tmpStr_;
-}
-
-
-void VariantLine::extract_field_ALT() {
-    this->altStr = this->tmpStr_;
+    if (this->tmpStr_.empty()) {
+        throw VcfPositionNotFound(this->tmpLine_);
+    }
+    this->pos = stoi(this->tmpStr_.c_str(), NULL);
 }
 
 
-void VariantLine::extract_field_QUAL() {  // Check for PASS
-    this->qualStr = this->tmpStr_;
+/*! stod() of the value after the '=' at eqIndex, without copying it out of
+ *  the INFO field. Throws as stod() does if there is no number. */
+double infoValue(const string & info, size_t eqIndex, size_t fieldEnd) {
+    if (eqIndex >= fieldEnd) {
+        throw std::invalid_argument("stod");
+    }
+    const char * begin = info.c_str() + eqIndex + 1;
+    char * end;
+    errno = 0;
+    double value = strtod(begin, &end);
+    if (end == begin) {
+        throw std::invalid_argument("stod");
+    }
+    if (errno == ERANGE) {
+        throw std::out_of_range("stod");
+    }
+    return value;
 }
 
 
-void VariantLine::extract_field_FILTER() {
-    this->filterStr = this->tmpStr_;
-}
-
 void VariantLine::extract_field_INFO() {
-    this->infoStr = this->tmpStr_;
     bool vqslodNotFound = true;
     size_t feild_start = 0;
     size_t field_end = 0;
@@ -365,19 +613,17 @@ void VariantLine::extract_field_INFO() {
     while (field_end < this->tmpStr_.size()) {
         field_end = min(this->tmpStr_.find(';', feild_start),
                         this->tmpStr_.find('\t', feild_start));
-        string filterFiledStr = this->tmpStr_.substr(feild_start,
-                                                     field_end-feild_start);
-        size_t eqIndex = filterFiledStr.find('=', 0);
-        string filterFiledName = filterFiledStr.substr(0, eqIndex);
-        if ( "VQSLOD" == filterFiledName ) {
+        // The key and the value are read where they are in the line
+        size_t eqIndex = min(this->tmpStr_.find('=', feild_start), field_end);
+        size_t keyLength = eqIndex - feild_start;
+        if (this->tmpStr_.compare(feild_start, keyLength, "VQSLOD") == 0) {
             vqslodNotFound = false;
-            vqslod = stod(filterFiledStr.substr(eqIndex+1,
-                                                filterFiledStr.size()));
+            vqslod = infoValue(this->tmpStr_, eqIndex, field_end);
         }
 
-        if ( ("AF" == filterFiledName) & (this->extractPlaf_) ) {
-            plaf = stod(filterFiledStr.substr(eqIndex+1,
-                                                filterFiledStr.size()));
+        if ((this->tmpStr_.compare(feild_start, keyLength, "AF") == 0) &
+                (this->extractPlaf_)) {
+            plaf = infoValue(this->tmpStr_, eqIndex, field_end);
         }
 
         feild_start = field_end+1;
@@ -393,16 +639,15 @@ void VariantLine::extract_field_INFO() {
 
 
 void VariantLine::extract_field_FORMAT() {
-    this->formatStr = this->tmpStr_;
     size_t feild_start = 0;
     size_t field_end = 0;
     size_t field_index = 0;
 
-    while (field_end < this->formatStr.size()) {
-        field_end = min(this->formatStr.find(':', feild_start),
-                        this->formatStr.find('\n', feild_start));
-        if ( "AD" == this->formatStr.substr(feild_start,
-                                            field_end-feild_start)) {
+    while (field_end < this->tmpStr_.size()) {
+        field_end = min(this->tmpStr_.find(':', feild_start),
+                        this->tmpStr_.find('\n', feild_start));
+        if (this->tmpStr_.compare(feild_start, field_end - feild_start,
+                                  "AD") == 0) {
             adFieldIndex_ = field_index;
             break;
         }
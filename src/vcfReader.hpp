@@ -23,13 +23,16 @@
  *
  */
 
+#include <stdint.h>     /* int32_t */
 #include <stdlib.h>     /* strtol, strtod */
 #include <string>  /* string */
 #include <vector>  /* vector */
-#include <fstream>
 #include "exceptions.hpp"
+#include "chromSubset.hpp"
+#include "inputSource.hpp"
+#include "gzIndex.hpp"
+#include "lineIndex.hpp"
 #include "variantIndex.hpp"
-#include "gzstream/gzstream.h"
 
 #ifndef DEPLOID_SRC_VCFREADER_HPP_
 #define DEPLOID_SRC_VCFREADER_HPP_
@@ -84,27 +87,43 @@ struct VcfVQSLODNotFound : public VcfInvalidVariantEntry{
 };
 
 
+struct VcfPositionNotFound : public VcfInvalidVariantEntry{
+    explicit VcfPositionNotFound(string str):VcfInvalidVariantEntry(str) {
+        this->reason = "POS was not found, check: ";
+        throwMsg = this->reason + this->src;
+    }
+    ~VcfPositionNotFound() throw() {}
+};
+
+
 class VariantLine{
+#ifdef UNITTEST
+  friend class TestVCF;
+#endif
   friend class VcfReader;
+  friend class CountIndex;
+  friend class VqslodIndex;
+  friend class VcfBatch;
   friend class DEploidIO;
  public:
-    explicit VariantLine(string tmpLine, size_t sampleColumnIndex,
+    VariantLine() : sampleColumnIndex_(0), extractPlaf_(false) {}
+    explicit VariantLine(const string & tmpLine, size_t sampleColumnIndex,
         bool extractPlaf = false);
     ~VariantLine() {}
+    /* Parse another line, into the buffers of the last one. A reader keeps
+     * one VariantLine, the sites are kept in its columns. */
+    void parse(const string & tmpLine, size_t sampleColumnIndex,
+               bool extractPlaf = false);
 
  private:
     string tmpLine_;
     string tmpStr_;
 
-    void init(string tmpLine, size_t sampleColumnIndex, bool extractPlaf);
+    void init(const string & tmpLine, size_t sampleColumnIndex,
+              bool extractPlaf);
 
     void extract_field_CHROM();
     void extract_field_POS();
-    void extract_field_ID();
-    void extract_field_REF();
-    void extract_field_ALT();
-    void extract_field_QUAL();
-    void extract_field_FILTER();
     void extract_field_INFO();
     void extract_field_FORMAT();
     void extract_field_VARIANT();
@@ -113,15 +132,8 @@ class VariantLine{
     size_t fieldEnd_;
     size_t fieldIndex_;
 
-    string chromStr;
-    string posStr;
-    string idStr;
-    string refStr;
-    string altStr;
-    string qualStr;
-    string filterStr;
-    string infoStr;
-    string formatStr;
+    ChromId chromId;
+    int pos;
     int adFieldIndex_;
 
     int ref;
@@ -134,54 +146,169 @@ class VariantLine{
 
 
 
+/*! What VcfReader::refresh() found in the file */
+enum VcfRefresh {
+    // No new complete line
+    VCF_UNCHANGED,
+    // New lines were read into the columns after the old ones
+    VCF_APPENDED,
+    // The file was truncated or rewritten, and read again from the start
+    VCF_RELOADED
+};
+
+
+/*! \brief Where VcfReader::refresh() reads on in a growing VCF file
+ *
+ *  The offset is just after the last complete line read. The file is
+ *  taken to be the same one as long as the checksums of its header, and of
+ *  the first data bytes up to the offset, are the same.
+ */
+struct VcfCheckpoint {
+    // False for gzipped files, pipes and memory, which are read again
+    bool valid;
+    uint64_t headerSize;
+    uint64_t offset;
+    uint64_t prefixEnd;
+    uint32_t headerCrc;
+    uint32_t prefixCrc;
+    // The last site read into the columns
+    string lastChrom;
+    int lastPos;
+
+    VcfCheckpoint() : valid(false), headerSize(0), offset(0), prefixEnd(0),
+                      headerCrc(0), prefixCrc(0), lastPos(0) {}
+};
+
+
 /*! \brief VCF file reader @ingroup group_data */
 class VcfReader : public VariantIndex {
 #ifdef UNITTEST
   friend class TestVCF;
+  friend class TestVqslodIndex;
+  friend class TestChromSubset;
+  friend class TestThreadPool;
+  friend class TestInputLoader;
+  friend class TestLineIndex;
+  friend class TestGzIndex;
 #endif
   friend class DEploidIO;
+  friend class CountIndex;
+  friend class VqslodIndex;
+  friend class VcfBatch;
  public:
     // Constructors and Destructors
+    VcfReader();
     explicit VcfReader(string fileName, string sampleName,
         bool extractPlaf = false);
+    explicit VcfReader(const InputSource & source, string sampleName,
+        bool extractPlaf = false);
     // parse in exclude sites
     ~VcfReader() {}
 
+    /* Read another file into this reader, as the constructor does. The
+     * buffers of the last file are cleared but keep their capacity, so one
+     * reader can go through many files without reallocating. */
+    void open(string fileName, string sampleName, bool extractPlaf = false);
+    /* Read from a pipe, standard input or memory, the file name "-" is
+     * standard input too */
+    void open(const InputSource & source, string sampleName,
+              bool extractPlaf = false);
+    /* Close the file and forget its content, keeping the capacity */
+    void reset();
+    /* Number of sites of the files to be opened, when it is known, e.g. all
+     * files of a cohort have the same sites. Zero, the default, has open()
+     * estimate it from the size of the file. */
+    void setSizeHint(const size_t nSites) { this->sizeHint_ = nSites; }
+    /* Only read the sites on these chromosomes, none for all of them */
+    void setChromosomes(const vector <string> & chrom) {
+        this->chromosomes_ = chrom; }
+    /* Read VCF files through their LineIndex sidecar, which is written on
+     * the first read. The number of sites is then known, and the
+     * chromosomes left out by setChromosomes() are skipped unread. A single
+     * member gzipped file also gets a GzIndex sidecar to seek in it. */
+    void setUseLineIndex(const bool use) { this->useLineIndex_ = use; }
+
+    /* Read the lines appended to the file since it was opened or last
+     * refreshed, e.g. while a caller is still writing it. Only complete
+     * lines are read, open() also leaves a last line of a plain file
+     * without its newline to it. They go into the columns after the sites
+     * already there, so
+     * call it before sites are removed, and finalize() again after it. The
+     * views of the columns taken before are no longer valid. A file that
+     * was truncated or rewritten is read again from the start, as is a
+     * gzipped file. A pipe or memory is read once and stays unchanged. */
+    VcfRefresh refresh();
+    const VcfCheckpoint & checkpoint() const { return this->checkpoint_; }
+
     // Members and Methods
     vector <string> headerLines;  // calling from python, need to be public
+    /* Double copies of the columns below, only filled by finalize() */
     vector <double> refCount;  // calling from python, need to be public
     vector <double> altCount;  // calling from python, need to be public
     vector <double> vqslod;  // calling from python, need to be public
     vector <double> plaf;
     void finalize();  // calling from python, need to be public
 
+    /* One value per variant, filled as the file is read and read as double
+     * without a copy. The columns are all that is kept of a site besides
+     * its position: the counts as int32, PLAF as float, and VQSLOD as
+     * double, so that the sites that pass a threshold are the same as in
+     * the file. */
+    DoubleView <int32_t> refCountColumn() const {
+        return DoubleView <int32_t>(this->refColumn_); }
+    DoubleView <int32_t> altCountColumn() const {
+        return DoubleView <int32_t>(this->altColumn_); }
+    DoubleView <double> vqslodColumn() const {
+        return DoubleView <double>(this->vqslodColumn_); }
+    DoubleView <float> plafColumn() const {
+        return DoubleView <float>(this->plafColumn_); }
+
  private:
-    vector <VariantLine> variants;
-    vector <VariantLine> keptVariants;
+    vector <int32_t> refColumn_;
+    vector <int32_t> altColumn_;
+    vector <double> vqslodColumn_;
+    vector <float> plafColumn_;
+    // The line being parsed
+    VariantLine variantLine_;
     vector <size_t> legitVqslodAt;
     string fileName_;
-    ifstream inFile;
-    igzstream inFileGz;
-    bool isCompressed_;
-    bool isCompressed() const { return this->isCompressed_; }
-    void setIsCompressed(const bool compressed) {
-        this->isCompressed_ = compressed; }
-    void checkFileCompressed();
+    InputStream in_;
+    bool isCompressed() const { return this->in_.isCompressed(); }
     string sampleName_;
     size_t sampleColumnIndex_;
     string tmpLine_;
     string tmpStr_;
     bool extractPlaf_;
+    size_t sizeHint_;
+    vector <string> chromosomes_;
+    vector <ChromId> chromosomeIds_;
+    bool useLineIndex_;
+    bool isFile_;
+    // Stop before a last line without its newline
+    bool completeLinesOnly_;
+    // Bytes of the file taken by nextLine()
+    uint64_t consumed_;
+    VcfCheckpoint checkpoint_;
 
     // Methods
-    void init(string fileName);
+    void init(const InputSource & source);
     void readVariants();
+    void readVariants(const vector <LineRange> & ranges,
+                      const GzIndex * gz);
+    void readVariantLines();
+    bool isWanted(const string & chrom) const;
     void readHeader();
+    /* The next line into tmpLine_, empty at the end of the input */
+    bool nextLine();
+    void setCheckpoint(const uint64_t headerSize, const uint64_t dataEnd);
+    void updateCheckpoint();
+    bool sameFile(uint64_t * fileSize) const;
     void checkFeilds();
     void findLegitSnpsGivenVQSLOD(double vqslodThreshold);
     void findLegitSnpsGivenVQSLODHalf(double vqslodThreshold);
+    void findLegitSnpsGivenVQSLOD(double vqslodThreshold,
+                                  const ChromSubset & subset);
 
-    void getChromList();
     void removeMarkers();
 
     // Debug tools
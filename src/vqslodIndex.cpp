@@ -0,0 +1,111 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <algorithm>  // stable_sort, upper_bound
+#include <cmath>  // isnan
+#include "vqslodIndex.hpp"
+
+
+VqslodIndex::VqslodIndex(const VcfReader & vcf) {
+    // The same values as VcfReader::vqslod, and so the same thresholds
+    DoubleView <double> vqslod = vcf.vqslodColumn();
+    this->nSites_ = vqslod.size();
+    this->order_.reserve(this->nSites_);
+    for (size_t i = 0; i < this->nSites_; i++) {
+        // NaN has no place in a sorted order, and no threshold keeps it
+        if (!std::isnan(vqslod[i])) {
+            this->order_.push_back(i);
+        }
+    }
+    std::stable_sort(this->order_.begin(), this->order_.end(),
+                     [&vqslod](size_t a, size_t b) {
+                         return vqslod[a] < vqslod[b]; });
+    this->sortedVqslod_.reserve(this->order_.size());
+    for (auto const &siteI : this->order_) {
+        this->sortedVqslod_.push_back(vqslod[siteI]);
+    }
+}
+
+
+size_t VqslodIndex::firstKept(const double threshold) const {
+    return std::upper_bound(this->sortedVqslod_.begin(),
+                            this->sortedVqslod_.end(), threshold) -
+           this->sortedVqslod_.begin();
+}
+
+
+size_t VqslodIndex::count(const double threshold) const {
+    return this->order_.size() - this->firstKept(threshold);
+}
+
+
+vector <size_t> VqslodIndex::count(const vector <double> & thresholds) const {
+    vector <size_t> counts;
+    counts.reserve(thresholds.size());
+    for (auto const &threshold : thresholds) {
+        counts.push_back(this->count(threshold));
+    }
+    return counts;
+}
+
+
+vector <size_t> VqslodIndex::keptSites(const double threshold) const {
+    vector <size_t> sites(this->order_.begin() + this->firstKept(threshold),
+                          this->order_.end());
+    std::sort(sites.begin(), sites.end());
+    return sites;
+}
+
+
+vector < vector <size_t> > VqslodIndex::keptSites(
+        const vector <double> & thresholds) const {
+    vector < vector <size_t> > sites;
+    sites.reserve(thresholds.size());
+    for (auto const &threshold : thresholds) {
+        sites.push_back(this->keptSites(threshold));
+    }
+    return sites;
+}
+
+
+vector <size_t> VqslodIndex::keptSites(const double threshold,
+                                       const ChromSubset & subset) const {
+    vector <size_t> sites;
+    for (auto const &siteI : this->keptSites(threshold)) {
+        if (subset.containsSite(siteI)) {
+            sites.push_back(siteI);
+        }
+    }
+    return sites;
+}
+
+
+vector <bool> VqslodIndex::keptMask(const double threshold) const {
+    vector <bool> mask(this->nSites_, false);
+    for (size_t i = this->firstKept(threshold); i < this->order_.size(); i++) {
+        mask[this->order_[i]] = true;
+    }
+    return mask;
+}
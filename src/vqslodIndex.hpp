@@ -0,0 +1,77 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEPLOID_SRC_VQSLODINDEX_HPP_
+#define DEPLOID_SRC_VQSLODINDEX_HPP_
+
+#include <vector>
+#include "chromSubset.hpp"
+#include "vcfReader.hpp"
+
+using std::vector;
+
+/*! \brief Sites of a loaded VcfReader sorted by VQSLOD, for sweeping
+ *  thresholds
+ *
+ *  A site is kept at a threshold if its VQSLOD is strictly greater, as in
+ *  VcfReader::findLegitSnpsGivenVQSLOD(). The kept sites of any threshold are
+ *  a suffix of the sorted order, so the count is a binary search and the
+ *  kept sites cost time in proportion to their number. Sites whose VQSLOD is
+ *  not a number are never kept.
+ */
+class VqslodIndex {
+#ifdef UNITTEST
+    friend class TestVqslodIndex;
+#endif
+ public:
+    explicit VqslodIndex(const VcfReader & vcf);
+    ~VqslodIndex() {}
+
+    size_t nSites() const { return this->nSites_; }
+    /*! Number of sites with VQSLOD > threshold, O(log n) */
+    size_t count(const double threshold) const;
+    vector <size_t> count(const vector <double> & thresholds) const;
+    /*! Sites with VQSLOD > threshold in site order, the same as
+     *  legitVqslodAt after findLegitSnpsGivenVQSLOD(threshold) */
+    vector <size_t> keptSites(const double threshold) const;
+    vector < vector <size_t> > keptSites(
+        const vector <double> & thresholds) const;
+    /*! keptSites() on the chromosomes of the subset */
+    vector <size_t> keptSites(const double threshold,
+                              const ChromSubset & subset) const;
+    /*! keptSites() as one flag per site */
+    vector <bool> keptMask(const double threshold) const;
+
+ private:
+    size_t nSites_;
+    // Site indices ordered by increasing VQSLOD, ties in site order
+    vector <size_t> order_;
+    // VQSLOD of order_[i]
+    vector <double> sortedVqslod_;
+
+    size_t firstKept(const double threshold) const;
+};
+
+#endif  // DEPLOID_SRC_VQSLODINDEX_HPP_
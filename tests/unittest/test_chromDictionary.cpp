@@ -0,0 +1,87 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "src/chromDictionary.hpp"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestChromDictionary : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestChromDictionary );
+    CPPUNIT_TEST( checkIntern );
+    CPPUNIT_TEST( checkContigLine );
+    CPPUNIT_TEST( checkSharedIds );
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void checkIntern() {
+        ChromDictionary & dictionary = ChromDictionary::global();
+        ChromId first = dictionary.intern("testChromA");
+        ChromId second = dictionary.intern("testChromB");
+        CPPUNIT_ASSERT( first != second );
+        CPPUNIT_ASSERT_EQUAL ( first, dictionary.intern("testChromA") );
+        CPPUNIT_ASSERT_EQUAL ( second, dictionary.intern("testChromB") );
+        CPPUNIT_ASSERT_EQUAL ( string("testChromA"), dictionary.name(first) );
+
+        ChromId found;
+        CPPUNIT_ASSERT( dictionary.find("testChromB", &found) );
+        CPPUNIT_ASSERT_EQUAL ( second, found );
+        size_t size = dictionary.size();
+        CPPUNIT_ASSERT( !dictionary.find("testChromNeverSeen", &found) );
+        CPPUNIT_ASSERT_EQUAL ( size, dictionary.size() );
+    }
+
+    void checkContigLine() {
+        ChromDictionary & dictionary = ChromDictionary::global();
+        CPPUNIT_ASSERT( dictionary.internContigLine(
+            "##contig=<ID=testContig1,length=640851>") );
+        CPPUNIT_ASSERT( dictionary.internContigLine("##contig=<ID=testContig2>") );
+        ChromId first, second;
+        CPPUNIT_ASSERT( dictionary.find("testContig1", &first) );
+        CPPUNIT_ASSERT( dictionary.find("testContig2", &second) );
+        CPPUNIT_ASSERT_EQUAL ( first + 1, second );
+
+        CPPUNIT_ASSERT( !dictionary.internContigLine("##fileformat=VCFv4.1") );
+        CPPUNIT_ASSERT( !dictionary.internContigLine("##contig=<length=1>") );
+    }
+
+    void checkSharedIds() {
+        VcfReader vcf("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        TxtReader panel;
+        panel.readFromFile("data/testData/labStrains.test.panel.txt");
+        CPPUNIT_ASSERT_EQUAL ( vcf.chrom_.size(), vcf.chromId_.size() );
+        CPPUNIT_ASSERT_EQUAL ( panel.chrom_.size(), panel.chromId_.size() );
+        for ( size_t i = 0; i < panel.chrom_.size(); i++ ) {
+            size_t vcfChromI = vcf.findChrom(panel.chromId_[i]);
+            CPPUNIT_ASSERT( vcfChromI < vcf.chrom_.size() );
+            CPPUNIT_ASSERT_EQUAL ( panel.chrom_[i], vcf.chrom_[vcfChromI] );
+            CPPUNIT_ASSERT_EQUAL ( panel.chrom_[i],
+                ChromDictionary::global().name(panel.chromId_[i]) );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestChromDictionary );
@@ -0,0 +1,137 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "src/chromSubset.hpp"
+#include "src/countIndex.hpp"
+#include "src/vcfReader.hpp"
+
+class TestChromSubset : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestChromSubset );
+    CPPUNIT_TEST( checkRanges );
+    CPPUNIT_TEST( checkComplement );
+    CPPUNIT_TEST( checkLegitSnpsHalf );
+    CPPUNIT_TEST( checkKeepGivenIndexHalf );
+    CPPUNIT_TEST( checkCountSummary );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    VcfReader * vcf_;
+    double threshold_;
+
+  public:
+    void setUp() {
+        this->vcf_ = new VcfReader("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        this->vcf_->finalize();
+        this->threshold_ = 2.0;
+    }
+
+    void tearDown() {
+        delete this->vcf_;
+    }
+
+    void checkRanges(){
+        vector <ChromId> chromIds;
+        chromIds.push_back(this->vcf_->chromId_[5]);
+        chromIds.push_back(this->vcf_->chromId_[2]);
+        ChromSubset subset(*this->vcf_, chromIds);
+        // In reader order, not in the order of the ids
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, subset.nChrom() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, subset.chromIndex(0) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)5, subset.chromIndex(1) );
+        CPPUNIT_ASSERT_EQUAL ( this->vcf_->chromId_[2], subset.chromId(0) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)(19 + 21), subset.nSites() );
+        CPPUNIT_ASSERT_EQUAL ( this->vcf_->indexOfChromStarts_[2], subset.sites(0).begin );
+        CPPUNIT_ASSERT_EQUAL ( this->vcf_->indexOfChromStarts_[3], subset.sites(0).end );
+        CPPUNIT_ASSERT_EQUAL ( this->vcf_->indexOfChromStarts_[5], subset.sites(1).begin );
+
+        vector <size_t> sites = subset.siteIndices();
+        CPPUNIT_ASSERT_EQUAL ( subset.nSites(), sites.size() );
+        for ( auto const &siteI : sites ){
+            CPPUNIT_ASSERT( subset.containsSite(siteI) );
+        }
+        CPPUNIT_ASSERT( !subset.containsSite(0) );
+        CPPUNIT_ASSERT( !subset.containsChrom(3) );
+
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, ChromSubset::all(*this->vcf_).nSites() );
+    }
+
+    void checkComplement(){
+        ChromSubset later = ChromSubset::from(*this->vcf_, 11);
+        ChromSubset earlier = later.complement();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)3, later.nChrom() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)11, earlier.nChrom() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, later.nSites() + earlier.nSites() );
+        for ( size_t chromI = 0; chromI < this->vcf_->chrom_.size(); chromI++ ){
+            CPPUNIT_ASSERT( later.containsChrom(chromI) != earlier.containsChrom(chromI) );
+        }
+    }
+
+    void checkLegitSnpsHalf(){
+        vector <size_t> expected;
+        for ( size_t i = 0; i < this->vcf_->nSites(); i++ ){
+            if ( this->vcf_->chromIndexOfSite(i) > 10 &&
+                 this->vcf_->vqslod[i] > this->threshold_ ){
+                expected.push_back(i);
+            }
+        }
+        this->vcf_->findLegitSnpsGivenVQSLODHalf(this->threshold_);
+        CPPUNIT_ASSERT( expected == this->vcf_->legitVqslodAt );
+        CPPUNIT_ASSERT( expected.size() > 0 );
+    }
+
+    void checkKeepGivenIndexHalf(){
+        this->vcf_->findLegitSnpsGivenVQSLOD(this->threshold_);
+        vector <size_t> legit = this->vcf_->legitVqslodAt;
+        vector <int> expectedPositions;
+        for ( auto const &siteI : legit ){
+            if ( this->vcf_->chromIndexOfSite(siteI) > 10 ){
+                expectedPositions.push_back(this->vcf_->position_.values()[siteI]);
+            }
+        }
+        // Sites on the other chromosomes are left out
+        this->vcf_->findWhoToBeKeptGivenIndexHalf(legit);
+        this->vcf_->setDoneGetIndexOfChromStarts(false);
+        this->vcf_->getIndexOfChromStartsHalf();
+        this->vcf_->removeMarkers();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)3, this->vcf_->chrom_.size() );
+        CPPUNIT_ASSERT_EQUAL ( this->vcf_->chrom_.size(), this->vcf_->position_.size() );
+        CPPUNIT_ASSERT_EQUAL ( expectedPositions.size(), this->vcf_->nLoci_ );
+        CPPUNIT_ASSERT( expectedPositions == this->vcf_->position_.values() );
+        CPPUNIT_ASSERT_EQUAL ( string("Pf3D7_12_v3"), this->vcf_->chrom_[0] );
+    }
+
+    void checkCountSummary(){
+        CountIndex counts(*this->vcf_);
+        ChromSubset later = ChromSubset::from(*this->vcf_, 11);
+        CountSummary summary = counts.summary(later);
+        CountSummary rest = counts.summary(later.complement());
+        CPPUNIT_ASSERT_EQUAL ( later.nSites(), summary.nSites );
+        CPPUNIT_ASSERT_EQUAL ( counts.total().depth(), summary.depth() + rest.depth() );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestChromSubset );
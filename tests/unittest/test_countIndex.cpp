@@ -0,0 +1,141 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include "src/countIndex.hpp"
+#include "src/vcfReader.hpp"
+
+class TestCountIndex : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestCountIndex );
+    CPPUNIT_TEST( checkRanges );
+    CPPUNIT_TEST( checkChromAndTotal );
+    CPPUNIT_TEST( checkWindows );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    VcfReader * vcf_;
+    CountIndex * counts_;
+    double eps;
+
+    // Sum over the sites by scanning the count columns
+    CountSummary scan(const string & chrom, int start, int end) {
+        CountSummary summary = {0, 0, 0, 0, 0.0};
+        for ( size_t i = 0; i < this->vcf_->nSites(); i++ ){
+            size_t chromI = this->vcf_->chromIndexOfSite(i);
+            int pos = this->vcf_->position_.values()[i];
+            if ( this->vcf_->chrom_[chromI] != chrom || pos < start || pos > end ){
+                continue;
+            }
+            double ref = this->vcf_->refCount[i];
+            double alt = this->vcf_->altCount[i];
+            summary.nSites++;
+            summary.refCount += ref;
+            summary.altCount += alt;
+            if ( ref + alt > 0 ){
+                summary.nCovered++;
+                summary.wsafSum += alt / (ref + alt);
+            }
+        }
+        return summary;
+    }
+
+    void compare(const CountSummary & expected, const CountSummary & found) {
+        CPPUNIT_ASSERT_EQUAL ( expected.nSites, found.nSites );
+        CPPUNIT_ASSERT_EQUAL ( expected.nCovered, found.nCovered );
+        CPPUNIT_ASSERT_EQUAL ( expected.refCount, found.refCount );
+        CPPUNIT_ASSERT_EQUAL ( expected.altCount, found.altCount );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( expected.wsafSum, found.wsafSum, this->eps );
+    }
+
+  public:
+    void setUp() {
+        this->vcf_ = new VcfReader("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        this->vcf_->finalize();
+        this->counts_ = new CountIndex(*this->vcf_);
+        this->eps = 0.000000001;
+    }
+
+    void tearDown() {
+        delete this->counts_;
+        delete this->vcf_;
+    }
+
+    void checkRanges(){
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, this->counts_->nSites() );
+        this->compare(this->scan("Pf3D7_01_v3", 0, 200000),
+                      this->counts_->summary("Pf3D7_01_v3", 0, 200000));
+        this->compare(this->scan("Pf3D7_01_v3", 100000, 150000),
+                      this->counts_->summary("Pf3D7_01_v3", 100000, 150000));
+        this->compare(this->scan("Pf3D7_07_v3", 1, 1000000000),
+                      this->counts_->summary("Pf3D7_07_v3", 1, 1000000000));
+        CountSummary nothing = this->counts_->summary("notAChrom", 1, 100);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, nothing.nSites );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( 0.0, nothing.meanDepth(), this->eps );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( 0.0, nothing.meanWsaf(), this->eps );
+    }
+
+    void checkChromAndTotal(){
+        size_t nSites = 0;
+        int64_t depth = 0;
+        for ( auto const &chrom : this->vcf_->chrom_ ){
+            CountSummary chromSummary = this->counts_->chromSummary(chrom);
+            this->compare(this->scan(chrom, 0, 1000000000), chromSummary);
+            nSites += chromSummary.nSites;
+            depth += chromSummary.depth();
+        }
+        CountSummary total = this->counts_->total();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, total.nSites );
+        CPPUNIT_ASSERT_EQUAL ( nSites, total.nSites );
+        CPPUNIT_ASSERT_EQUAL ( depth, total.depth() );
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( static_cast<double>(depth) / 594,
+                                       total.meanDepth(), this->eps );
+    }
+
+    void checkWindows(){
+        int windowSize = 10000;
+        vector <CountWindow> windows = this->counts_->windows(windowSize);
+        size_t nSites = 0;
+        for ( auto const &window : windows ){
+            CPPUNIT_ASSERT_EQUAL ( windowSize - 1, window.end - window.start );
+            CPPUNIT_ASSERT_EQUAL ( 1, window.start % windowSize );
+            this->compare(this->scan(window.chrom, window.start, window.end),
+                          window.summary);
+            nSites += window.summary.nSites;
+        }
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, nSites );
+
+        std::ostringstream out;
+        this->counts_->writeWindows(out, windowSize);
+        size_t nLines = 0;
+        for ( auto const &c : out.str() ){
+            nLines += (c == '\n') ? 1 : 0;
+        }
+        CPPUNIT_ASSERT_EQUAL ( windows.size() + 1, nLines );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestCountIndex );
@@ -0,0 +1,167 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "src/deploidVcf.h"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestDeploidVcf : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestDeploidVcf );
+    CPPUNIT_TEST( checkVcf );
+    CPPUNIT_TEST( checkPanel );
+    CPPUNIT_TEST( checkInfo );
+    CPPUNIT_TEST( checkErrors );
+    CPPUNIT_TEST( checkRaggedMatrix );
+    CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp() {}
+    void tearDown() {}
+
+    void checkVcf() {
+        dvcf_vcf * vcf = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_OK,
+            dvcf_vcf_open("data/testData/PG0390-C.test.vcf.gz", "PG0390-C", 1, &vcf) );
+        VcfReader reader("data/testData/PG0390-C.test.vcf.gz", "PG0390-C", true);
+
+        size_t nSites = dvcf_vcf_n_sites(vcf);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, nSites );
+        CPPUNIT_ASSERT_EQUAL ( reader.headerLines.size(), dvcf_vcf_n_header_lines(vcf) );
+        CPPUNIT_ASSERT ( reader.headerLines[0] == dvcf_vcf_header_line(vcf, 0) );
+        CPPUNIT_ASSERT ( dvcf_vcf_header_line(vcf, reader.headerLines.size()) == NULL );
+
+        // The columns are the memory of the reader
+        CPPUNIT_ASSERT ( dvcf_vcf_ref_count(vcf) == dvcf_vcf_ref_count(vcf) );
+        for (size_t i = 0; i < nSites; i++) {
+            CPPUNIT_ASSERT_EQUAL ( reader.refCountColumn().raw()[i], dvcf_vcf_ref_count(vcf)[i] );
+            CPPUNIT_ASSERT_EQUAL ( reader.altCountColumn().raw()[i], dvcf_vcf_alt_count(vcf)[i] );
+            CPPUNIT_ASSERT_EQUAL ( reader.vqslodColumn().raw()[i], dvcf_vcf_vqslod(vcf)[i] );
+            CPPUNIT_ASSERT_EQUAL ( reader.plafColumn().raw()[i], dvcf_vcf_plaf(vcf)[i] );
+        }
+        CPPUNIT_ASSERT_EQUAL ( 85, dvcf_vcf_ref_count(vcf)[0] );
+
+        size_t nChrom = dvcf_vcf_n_chrom(vcf);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)14, nChrom );
+        CPPUNIT_ASSERT_EQUAL ( std::string("Pf3D7_01_v3"), std::string(dvcf_vcf_chrom(vcf, 0)) );
+        CPPUNIT_ASSERT ( dvcf_vcf_chrom(vcf, nChrom) == NULL );
+        const uint64_t * offsets = dvcf_vcf_chrom_offsets(vcf);
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)0, offsets[0] );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)nSites, offsets[nChrom] );
+        CPPUNIT_ASSERT_EQUAL ( 93157, dvcf_vcf_positions(vcf)[0] );
+        CPPUNIT_ASSERT_EQUAL ( 94422, dvcf_vcf_positions(vcf)[1] );
+        dvcf_vcf_free(vcf);
+    }
+
+    void checkPanel() {
+        dvcf_txt * txt = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_OK,
+            dvcf_txt_open("data/testData/labStrains.test.panel.txt", &txt) );
+        TxtReader reader;
+        reader.readFromFile("data/testData/labStrains.test.panel.txt");
+
+        size_t nSites = dvcf_txt_n_sites(txt);
+        size_t nColumns = dvcf_txt_n_columns(txt);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, nSites );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, nColumns );
+        CPPUNIT_ASSERT_EQUAL ( std::string("threeD7"), std::string(dvcf_txt_column_name(txt, 0)) );
+        CPPUNIT_ASSERT ( dvcf_txt_column_name(txt, nColumns) == NULL );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)14, dvcf_txt_n_chrom(txt) );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)nSites, dvcf_txt_chrom_offsets(txt)[14] );
+        CPPUNIT_ASSERT_EQUAL ( 93157, dvcf_txt_positions(txt)[0] );
+
+        std::vector <double> matrix(nSites * nColumns);
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_OK,
+            dvcf_txt_copy_matrix(txt, matrix.data(), matrix.size()) );
+        for (size_t i = 0; i < nSites; i++) {
+            for (size_t j = 0; j < nColumns; j++) {
+                CPPUNIT_ASSERT_EQUAL ( reader.content_[i][j], dvcf_txt_row(txt, i)[j] );
+                CPPUNIT_ASSERT_EQUAL ( reader.content_[i][j], matrix[i * nColumns + j] );
+            }
+        }
+        CPPUNIT_ASSERT ( dvcf_txt_row(txt, nSites) == NULL );
+        CPPUNIT_ASSERT ( dvcf_txt_info(txt) == NULL );
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR,
+            dvcf_txt_copy_matrix(txt, matrix.data(), matrix.size() - 1) );
+        dvcf_txt_free(txt);
+    }
+
+    void checkInfo() {
+        dvcf_txt * txt = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_OK,
+            dvcf_txt_open("data/testData/PG0390-C.test.ref", &txt) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, dvcf_txt_n_columns(txt) );
+        CPPUNIT_ASSERT_EQUAL ( std::string("PG0390-C"), std::string(dvcf_txt_column_name(txt, 0)) );
+        CPPUNIT_ASSERT_EQUAL ( 85.0, dvcf_txt_info(txt)[0] );
+        CPPUNIT_ASSERT_EQUAL ( 77.0, dvcf_txt_info(txt)[1] );
+        CPPUNIT_ASSERT_EQUAL ( dvcf_txt_info(txt)[1], dvcf_txt_row(txt, 1)[0] );
+        dvcf_txt_free(txt);
+    }
+
+    void checkErrors() {
+        dvcf_vcf * vcf = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR,
+            dvcf_vcf_open("data/testData/noSuchFile.vcf", "PG0390-C", 0, &vcf) );
+        CPPUNIT_ASSERT ( vcf == NULL );
+        CPPUNIT_ASSERT ( std::string(dvcf_last_error()).find("noSuchFile") != std::string::npos );
+
+        dvcf_txt * txt = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR,
+            dvcf_txt_open("data/testData/bad.plaf_badpos.txt", &txt) );
+        CPPUNIT_ASSERT ( txt == NULL );
+        CPPUNIT_ASSERT ( std::string(dvcf_last_error()).size() > 0 );
+        CPPUNIT_ASSERT_EQUAL ( DVCF_ABI_VERSION, dvcf_abi_version() );
+
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR,
+            dvcf_vcf_open(NULL, "PG0390-C", 0, &vcf) );
+        CPPUNIT_ASSERT ( vcf == NULL );
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR, dvcf_txt_open(NULL, &txt) );
+        CPPUNIT_ASSERT ( txt == NULL );
+    }
+
+    void checkRaggedMatrix() {
+        const char * fileName = "deploidVcfRagged.txt";
+        std::ofstream out(fileName);
+        out << "CHROM\tPOS\ta\tb\n"
+            << "Pf3D7_01_v3\t100\t1\t2\n"
+            << "Pf3D7_01_v3\t200\t3\n";
+        out.close();
+        dvcf_txt * txt = NULL;
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_OK, dvcf_txt_open(fileName, &txt) );
+        std::vector <double> matrix(2 * dvcf_txt_n_columns(txt), -1.0);
+        CPPUNIT_ASSERT_EQUAL ( (int)DVCF_ERROR,
+            dvcf_txt_copy_matrix(txt, matrix.data(), matrix.size()) );
+        CPPUNIT_ASSERT_EQUAL ( -1.0, matrix[0] );
+        dvcf_txt_free(txt);
+        std::remove(fileName);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestDeploidVcf );
@@ -0,0 +1,239 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "src/gzIndex.hpp"
+#include "src/gzstream/gzstream.h"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestGzIndex : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestGzIndex );
+    CPPUNIT_TEST( checkBuild );
+    CPPUNIT_TEST( checkExtract );
+    CPPUNIT_TEST( checkSidecar );
+    CPPUNIT_TEST( checkTxtReader );
+    CPPUNIT_TEST( checkVcfReader );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    const char * txtFile_;
+    const char * vcfFile_;
+    std::string txtData_;
+    size_t nTxtRows_;
+
+    std::string readFile(const char * fileName) {
+        std::ifstream in(fileName, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const char * fileName, const std::string & data) {
+        std::ofstream out(fileName, std::ios::binary);
+        out << data;
+    }
+
+    // One gzip member, as gzip writes it
+    void writeGzip(const char * fileName, const std::string & data) {
+        ogzstream out(fileName);
+        out << data;
+        out.close();
+    }
+
+    void removeWithSidecars(const char * fileName) {
+        std::remove(fileName);
+        std::remove(LineIndex::sidecarName(fileName).c_str());
+        std::remove(GzIndex::sidecarName(fileName).c_str());
+    }
+
+    void compareIndex(const VariantIndex & expected,
+                      const VariantIndex & index) {
+        CPPUNIT_ASSERT ( expected.chrom_ == index.chrom_ );
+        CPPUNIT_ASSERT ( expected.position_.values() == index.position_.values() );
+        CPPUNIT_ASSERT ( expected.position_.offsets() == index.position_.offsets() );
+    }
+
+  public:
+    void setUp() {
+        this->txtFile_ = "data/testData/gzIndex.test.txt.gz";
+        this->vcfFile_ = "data/testData/gzIndex.test.vcf.gz";
+        this->nTxtRows_ = 20000;
+        this->txtData_ = "CHROM\tPOS\tPLAF\n";
+        for (size_t i = 0; i < this->nTxtRows_; i++) {
+            this->txtData_ += (i < 15000) ? "Pf3D7_01_v3\t" : "Pf3D7_02_v3\t";
+            // Scattered values, so that the deflate blocks are short
+            this->txtData_ += std::to_string((i + 1) * 10) + "\t0." +
+                              std::to_string(i * 2654435761u % 1000003) +
+                              "\n";
+        }
+        this->writeGzip(this->txtFile_, this->txtData_);
+        this->writeGzip(this->vcfFile_, this->readFile("data/testData/PG0390-C.test.vcf"));
+    }
+
+    void tearDown() {
+        this->removeWithSidecars(this->txtFile_);
+        this->removeWithSidecars(this->vcfFile_);
+    }
+
+    void checkBuild() {
+        GzIndex index;
+        index.setSpan(1 << 14);
+        LineIndex lines;
+        CPPUNIT_ASSERT ( index.build(this->txtFile_, 1, &lines) );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->txtData_.size(), index.outSize() );
+        CPPUNIT_ASSERT ( index.nPoints() > 3 );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)0, index.points_[0].out );
+        for (size_t i = 1; i < index.nPoints(); i++) {
+            CPPUNIT_ASSERT ( index.points_[i].out - index.points_[i-1].out > (1 << 14) );
+            CPPUNIT_ASSERT_EQUAL ( std::min(index.points_[i].out, (uint64_t)GzIndex::windowSize_),
+                                   (uint64_t)index.points_[i].window.size() );
+        }
+
+        // The lines are those of the inflated data
+        LineIndex expected;
+        expected.build(this->txtFile_, 1);
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->nTxtRows_, lines.nLines() );
+        CPPUNIT_ASSERT_EQUAL ( expected.dataStart(), lines.dataStart() );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->txtData_.size(), lines.dataEnd() );
+        CPPUNIT_ASSERT ( expected.chromNames() == lines.chromNames() );
+        CPPUNIT_ASSERT_EQUAL ( expected.chromRuns()[1].begin, lines.chromRuns()[1].begin );
+        CPPUNIT_ASSERT ( expected.samples_ == lines.samples_ );
+
+        // Several members, as bgzip writes them, are not indexed
+        CPPUNIT_ASSERT ( !index.build("data/testData/PG0390-C.test.vcf.gz") );
+        CPPUNIT_ASSERT ( !index.loadOrBuild("data/testData/PG0390-C.test.vcf", 0, &lines) );
+        CPPUNIT_ASSERT_THROW ( index.build("data/testData/noSuchFile.txt.gz"), InvalidInputFile );
+    }
+
+    void checkExtract() {
+        GzIndex index;
+        index.setSpan(1 << 14);
+        CPPUNIT_ASSERT ( index.build(this->txtFile_) );
+        std::string bytes;
+        uint64_t size = this->txtData_.size();
+        uint64_t offsets[] = {0, 1, 100, 16383, 16384, 50000, 123457,
+                              index.points_[3].out, size - 10, size};
+        for ( auto begin : offsets ) {
+            uint64_t end = std::min(size, begin + 40000);
+            index.extract(this->txtFile_, begin, end, &bytes);
+            CPPUNIT_ASSERT ( this->txtData_.substr(begin, end - begin) == bytes );
+        }
+        index.extract(this->txtFile_, 0, size, &bytes);
+        CPPUNIT_ASSERT ( this->txtData_ == bytes );
+        CPPUNIT_ASSERT_THROW ( index.extract(this->txtFile_, 0, size + 1, &bytes), InvalidInputFile );
+    }
+
+    void checkSidecar() {
+        GzIndex built;
+        built.setSpan(1 << 14);
+        LineIndex lines;
+        CPPUNIT_ASSERT ( built.loadOrBuild(this->txtFile_, 1, &lines) );
+        CPPUNIT_ASSERT ( std::ifstream(GzIndex::sidecarName(this->txtFile_).c_str()).good() );
+        CPPUNIT_ASSERT ( std::ifstream(LineIndex::sidecarName(this->txtFile_).c_str()).good() );
+
+        GzIndex loaded;
+        CPPUNIT_ASSERT ( loaded.read(this->txtFile_) );
+        CPPUNIT_ASSERT_EQUAL ( built.nPoints(), loaded.nPoints() );
+        CPPUNIT_ASSERT_EQUAL ( built.outSize(), loaded.outSize() );
+        for (size_t i = 0; i < built.nPoints(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( built.points_[i].in, loaded.points_[i].in );
+            CPPUNIT_ASSERT_EQUAL ( built.points_[i].bits, loaded.points_[i].bits );
+            CPPUNIT_ASSERT ( built.points_[i].window == loaded.points_[i].window );
+        }
+        std::string bytes;
+        loaded.extract(this->txtFile_, 200000, 200100, &bytes);
+        CPPUNIT_ASSERT ( this->txtData_.substr(200000, 100) == bytes );
+
+        // The file is rewritten, the sidecar is out of date
+        this->writeGzip(this->txtFile_, this->txtData_ + "Pf3D7_02_v3\t200010\t0.5\n");
+        CPPUNIT_ASSERT ( !loaded.read(this->txtFile_) );
+        CPPUNIT_ASSERT ( loaded.loadOrBuild(this->txtFile_, 1, &lines) );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->nTxtRows_ + 1, lines.nLines() );
+
+        // A corrupted sidecar is not used
+        bytes = this->readFile(GzIndex::sidecarName(this->txtFile_).c_str());
+        bytes[bytes.size() / 2] ^= 1;
+        this->writeFile(GzIndex::sidecarName(this->txtFile_).c_str(), bytes);
+        CPPUNIT_ASSERT ( !loaded.read(this->txtFile_) );
+    }
+
+    void checkTxtReader() {
+        TxtReader expected;
+        expected.readFromFile(this->txtFile_);
+        size_t nThreads[] = {1, 4};
+        // The first read writes the sidecars, the others use them
+        for ( auto n : nThreads ) {
+            TxtReader indexed;
+            indexed.setNumThreads(n);
+            indexed.setUseLineIndex(true);
+            indexed.readFromFile(this->txtFile_);
+            this->compareIndex(expected, indexed);
+            CPPUNIT_ASSERT ( expected.info_ == indexed.info_ );
+        }
+        CPPUNIT_ASSERT ( std::ifstream(GzIndex::sidecarName(this->txtFile_).c_str()).good() );
+
+        // Only the chromosome on the allow-list is inflated
+        std::vector <std::string> chrom(1, "Pf3D7_02_v3");
+        std::vector < std::vector <int> > position(1, std::vector <int>(1, 150010));
+        TxtReader allowed;
+        allowed.setAllowedPositions(chrom, position);
+        allowed.setUseLineIndex(true);
+        allowed.setNumThreads(4);
+        allowed.readFromFile(this->txtFile_);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, allowed.content_.size() );
+        CPPUNIT_ASSERT_EQUAL ( 150010, allowed.position_.values()[0] );
+    }
+
+    void checkVcfReader() {
+        VcfReader expected("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        std::vector <std::string> chrom(1, "Pf3D7_02_v3");
+        VcfReader filtered;
+        filtered.setChromosomes(chrom);
+        filtered.open("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        // Twice, the first open writes the sidecars
+        for (size_t i = 0; i < 2; i++) {
+            VcfReader indexed;
+            indexed.setUseLineIndex(true);
+            indexed.open(this->vcfFile_, "PG0390-C");
+            this->compareIndex(expected, indexed);
+            CPPUNIT_ASSERT ( expected.refCountColumn().toVector() == indexed.refCountColumn().toVector() );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)594, indexed.refColumn_.capacity() );
+
+            indexed.setChromosomes(chrom);
+            indexed.open(this->vcfFile_, "PG0390-C");
+            this->compareIndex(filtered, indexed);
+            CPPUNIT_ASSERT ( filtered.altCountColumn().toVector() == indexed.altCountColumn().toVector() );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestGzIndex );
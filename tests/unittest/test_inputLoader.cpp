@@ -0,0 +1,127 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "src/exceptions.hpp"
+#include "src/inputLoader.hpp"
+#include "src/threadPool.hpp"
+
+class TestInputLoader : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestInputLoader );
+    CPPUNIT_TEST( checkAllInputs );
+    CPPUNIT_TEST( checkCallerReader );
+    CPPUNIT_TEST( checkMissingFile );
+    CPPUNIT_TEST( checkTypedException );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    size_t sharedThreads_;
+
+  public:
+    void setUp() {
+        this->sharedThreads_ = ThreadPool::shared().nThreads();
+        ThreadPool::shared().setNumThreads(4);
+    }
+
+    void tearDown() {
+        ThreadPool::shared().setNumThreads(this->sharedThreads_);
+    }
+
+    void checkSameSites(TxtReader * expected, TxtReader * loaded) {
+        CPPUNIT_ASSERT_EQUAL ( expected->nLoci_, loaded->nLoci_ );
+        CPPUNIT_ASSERT ( expected->chrom_ == loaded->chrom_ );
+        CPPUNIT_ASSERT ( expected->position_.values() ==
+                         loaded->position_.values() );
+        CPPUNIT_ASSERT ( expected->info_ == loaded->info_ );
+        CPPUNIT_ASSERT ( expected->content_ == loaded->content_ );
+    }
+
+    void checkAllInputs() {
+        InputLoader loader;
+        loader.setVcf("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        loader.setRef("data/testData/PG0390-C.test.ref");
+        loader.setAlt("data/testData/PG0390-C.test.alt");
+        loader.setPlaf("data/testData/labStrains.test.PLAF.txt");
+        loader.setPanel("data/testData/labStrains.test.panel.txt");
+        loader.setExclude("data/testData/labStrains.test.exclude.txt");
+        loader.load();
+
+        VcfReader vcf("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        vcf.finalize();
+        loader.vcf()->finalize();
+        CPPUNIT_ASSERT ( vcf.refCount == loader.vcf()->refCount );
+        CPPUNIT_ASSERT ( vcf.altCount == loader.vcf()->altCount );
+        CPPUNIT_ASSERT ( vcf.chrom_ == loader.vcf()->chrom_ );
+
+        const char * files[] = {"data/testData/PG0390-C.test.ref",
+                                "data/testData/PG0390-C.test.alt",
+                                "data/testData/labStrains.test.PLAF.txt",
+                                "data/testData/labStrains.test.panel.txt"};
+        TxtReader * loaded[] = {loader.ref(), loader.alt(), loader.plaf(),
+                                loader.panel()};
+        for ( size_t i = 0; i < 4; i++ ) {
+            TxtReader expected;
+            expected.readFromFile(files[i]);
+            this->checkSameSites(&expected, loaded[i]);
+        }
+        ExcludeMarker exclude;
+        exclude.readFromFile("data/testData/labStrains.test.exclude.txt");
+        this->checkSameSites(&exclude, loader.exclude());
+    }
+
+    void checkCallerReader() {
+        TxtReader panel;
+        InputLoader loader;
+        loader.setPanel("data/testData/labStrains.test.panel.txt", &panel);
+        loader.load();
+        CPPUNIT_ASSERT ( loader.panel() == &panel );
+        CPPUNIT_ASSERT ( loader.vcf() == NULL );
+        CPPUNIT_ASSERT ( loader.ref() == NULL );
+        CPPUNIT_ASSERT ( panel.nLoci_ > 0 );
+    }
+
+    void checkMissingFile() {
+        InputLoader loader;
+        loader.setRef("data/testData/PG0390-C.test.ref");
+        loader.setAlt("data/testData/PG0390-C.test.missing.alt");
+        loader.setPlaf("data/testData/labStrains.test.PLAF.txt");
+        CPPUNIT_ASSERT_THROW ( loader.load(), InvalidInputFile );
+    }
+
+    void checkTypedException() {
+        // Both inputs fail, the error of the earlier input is the one thrown
+        InputLoader loader;
+        loader.setVcf("data/testData/PG0390-C.test.vcf", "not-a-sample");
+        loader.setPlaf("data/testData/bad.plaf_scientific.txt");
+        CPPUNIT_ASSERT_THROW ( loader.load(), InvalidSampleInVcf );
+
+        InputLoader plafOnly;
+        plafOnly.setPlaf("data/testData/bad.plaf_scientific.txt");
+        CPPUNIT_ASSERT_THROW ( plafOnly.load(), BadScientificNotation );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestInputLoader );
@@ -0,0 +1,276 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <unistd.h>  // pipe, write, close
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include "src/binaryPanel.hpp"
+#include "src/inputSource.hpp"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestInputSource : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestInputSource );
+    CPPUNIT_TEST( checkSniffing );
+    CPPUNIT_TEST( checkMissingFile );
+    CPPUNIT_TEST( checkReadError );
+    CPPUNIT_TEST( checkTruncatedGzip );
+    CPPUNIT_TEST( checkVcfFromMemory );
+    CPPUNIT_TEST( checkVcfFromPipe );
+    CPPUNIT_TEST( checkTxtFromMemory );
+    CPPUNIT_TEST( checkTxtFromPipe );
+    CPPUNIT_TEST( checkBinaryPanelFromMemory );
+    CPPUNIT_TEST( checkLastLine );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    std::string readFile(const char * fileName) {
+        std::ifstream in(fileName, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    }
+
+    // The other end of the pipe is written from a thread, the files are
+    // larger than the buffer of a pipe
+    struct Pipe {
+        int fd[2];
+        std::thread writer;
+        explicit Pipe(const std::string & data) {
+            CPPUNIT_ASSERT_EQUAL ( 0, pipe(this->fd) );
+            int writeFd = this->fd[1];
+            this->writer = std::thread([writeFd, &data]() {
+                size_t written = 0;
+                while (written < data.size()) {
+                    ssize_t n = write(writeFd, data.data() + written,
+                                      data.size() - written);
+                    if (n <= 0) {
+                        break;
+                    }
+                    written += n;
+                }
+                close(writeFd);
+            });
+        }
+        ~Pipe() {
+            this->writer.join();
+            close(this->fd[0]);
+        }
+    };
+
+    void compareIndex(const VariantIndex & expected,
+                      const VariantIndex & index) {
+        CPPUNIT_ASSERT ( expected.chrom_ == index.chrom_ );
+        CPPUNIT_ASSERT ( expected.position_.values() == index.position_.values() );
+        CPPUNIT_ASSERT ( expected.position_.offsets() == index.position_.offsets() );
+    }
+
+    void compareVcf(const VcfReader & expected, const VcfReader & vcf) {
+        this->compareIndex(expected, vcf);
+        CPPUNIT_ASSERT ( expected.headerLines == vcf.headerLines );
+        CPPUNIT_ASSERT ( expected.refCountColumn().toVector() == vcf.refCountColumn().toVector() );
+        CPPUNIT_ASSERT ( expected.altCountColumn().toVector() == vcf.altCountColumn().toVector() );
+        CPPUNIT_ASSERT ( expected.vqslodColumn().toVector() == vcf.vqslodColumn().toVector() );
+    }
+
+    void compareTxt(const TxtReader & expected, const TxtReader & txt) {
+        this->compareIndex(expected, txt);
+        CPPUNIT_ASSERT ( expected.content_ == txt.content_ );
+    }
+
+  public:
+    void setUp() {}
+    void tearDown() {}
+
+    void checkSniffing() {
+        std::string plain = this->readFile("data/testData/PG0390-C.test.vcf");
+        std::string gz = this->readFile("data/testData/PG0390-C.test.vcf.gz");
+        InputStream in;
+        in.open(InputSource::memory(plain.data(), plain.size()));
+        CPPUNIT_ASSERT ( !in.isCompressed() );
+        size_t nHead;
+        const char * head = in.head(&nHead);
+        CPPUNIT_ASSERT_EQUAL ( SourceBuf::headSize, nHead );
+        CPPUNIT_ASSERT_EQUAL ( std::string("##fileformat"), std::string(head, nHead) + "rmat" );
+        std::string all((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+        CPPUNIT_ASSERT ( all == plain );
+
+        // BGZF, all blocks are inflated
+        in.open(InputSource::memory(gz.data(), gz.size()));
+        CPPUNIT_ASSERT ( in.isCompressed() );
+        all.assign((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+        CPPUNIT_ASSERT ( all == plain );
+
+        // Inputs shorter than the head
+        in.open(InputSource::memory("\x1f", 1));
+        in.head(&nHead);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, nHead );
+        CPPUNIT_ASSERT ( !in.isCompressed() );
+        in.open(InputSource::memory("", 0));
+        in.head(&nHead);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, nHead );
+        CPPUNIT_ASSERT_EQUAL ( std::char_traits<char>::eof(), in.get() );
+        in.close();
+        CPPUNIT_ASSERT ( !in.isOpen() );
+    }
+
+    void checkMissingFile() {
+        InputStream in;
+        CPPUNIT_ASSERT_THROW ( in.open(InputSource::path("data/testData/noSuchFile.txt")), InvalidInputFile );
+        CPPUNIT_ASSERT_THROW ( in.open(InputSource::fd(-1)), InvalidInputFile );
+        CPPUNIT_ASSERT_EQUAL ( std::string("fd 5"), InputSource::fd(5).name() );
+        CPPUNIT_ASSERT_EQUAL ( std::string("stdin"), InputSource::fromName("-").name() );
+        CPPUNIT_ASSERT ( InputSource::fromName("-").kind() == InputSource::FD );
+        CPPUNIT_ASSERT ( InputSource::fromName("a.vcf").isPath() );
+    }
+
+    void checkVcfFromMemory() {
+        VcfReader expected("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        const char * files[] = {"data/testData/PG0390-C.test.vcf",
+                                "data/testData/PG0390-C.test.vcf.gz"};
+        for ( auto file : files ) {
+            std::string data = this->readFile(file);
+            VcfReader vcf(InputSource::memory(data.data(), data.size()), "PG0390-C");
+            CPPUNIT_ASSERT_EQUAL ( (size_t)594, vcf.nSites() );
+            this->compareVcf(expected, vcf);
+        }
+    }
+
+    void checkVcfFromPipe() {
+        VcfReader expected("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        std::string data = this->readFile("data/testData/PG0390-C.test.vcf.gz");
+        Pipe pipe(data);
+        VcfReader vcf;
+        vcf.open(InputSource::fd(pipe.fd[0], "bcftools"), "PG0390-C");
+        this->compareVcf(expected, vcf);
+    }
+
+    void checkTxtFromMemory() {
+        const char * files[] = {"data/testData/labStrains.test.panel.txt",
+                                "data/testData/labStrains.test.panel.txt.gz",
+                                "data/testData/PG0390-C.test.ref"};
+        for ( auto file : files ) {
+            TxtReader expected;
+            expected.readFromFile(file);
+            std::string data = this->readFile(file);
+            TxtReader txt;
+            txt.readFromSource(InputSource::memory(data.data(), data.size()));
+            this->compareTxt(expected, txt);
+            // The parallel reader reads the same
+            TxtReader parallel;
+            parallel.setNumThreads(3);
+            parallel.readFromSource(InputSource::memory(data.data(), data.size()));
+            this->compareTxt(expected, parallel);
+        }
+    }
+
+    void checkTxtFromPipe() {
+        TxtReader expected;
+        expected.readFromFile("data/testData/labStrains.test.panel.txt.gz");
+        std::string data = this->readFile("data/testData/labStrains.test.panel.txt.gz");
+        Pipe pipe(data);
+        TxtReader txt;
+        txt.readFromSource(InputSource::fd(pipe.fd[0]));
+        this->compareTxt(expected, txt);
+    }
+
+    void checkBinaryPanelFromMemory() {
+        const char * binFile = "binaryPanelForTesting.bin";
+        TxtReader expected;
+        expected.readFromFile("data/testData/labStrains.test.panel.txt");
+        BinaryPanel::write(expected, binFile);
+        std::string data = this->readFile(binFile);
+        std::remove(binFile);
+
+        TxtReader binary;
+        binary.readFromSource(InputSource::memory(data.data(), data.size()));
+        this->compareTxt(expected, binary);
+        Pipe pipe(data);
+        TxtReader piped;
+        piped.readFromSource(InputSource::fd(pipe.fd[0]));
+        this->compareTxt(expected, piped);
+    }
+
+    void checkReadError() {
+        // A directory opens, but reading it fails, which is not the end
+        // of an empty input
+        InputStream in;
+        CPPUNIT_ASSERT_THROW ( in.open(InputSource::path("data/testData")), InvalidInputFile );
+        TxtReader txt;
+        CPPUNIT_ASSERT_THROW ( txt.readFromSource(InputSource::path("data/testData")), InvalidInputFile );
+    }
+
+    void checkTruncatedGzip() {
+        std::string gz = this->readFile("data/testData/PG0390-C.test.vcf.gz");
+        // Cut inside the deflate data, and cut before the gzip trailer
+        std::string halves[] = {gz.substr(0, gz.size() / 2),
+                                gz.substr(0, gz.size() - 4)};
+        for ( auto const &data : halves ) {
+            InputStream in;
+            in.open(InputSource::memory(data.data(), data.size()));
+            std::string line;
+            CPPUNIT_ASSERT_THROW ( while (getline(in, line)) {}, InvalidInputFile );
+            VcfReader vcf;
+            CPPUNIT_ASSERT_THROW ( vcf.open(InputSource::memory(data.data(), data.size()), "PG0390-C"), InvalidInputFile );
+        }
+        // Corrupted deflate data
+        std::string corrupted = gz;
+        for ( size_t i = gz.size() / 2; i < gz.size() / 2 + 64; i++ ) {
+            corrupted[i] = ~corrupted[i];
+        }
+        const char * gzFile = "truncatedForTesting.vcf.gz";
+        std::ofstream out(gzFile, std::ios::binary);
+        out.write(corrupted.data(), corrupted.size());
+        out.close();
+        CPPUNIT_ASSERT_THROW ( VcfReader(gzFile, "PG0390-C"), InvalidInputFile );
+        std::remove(gzFile);
+    }
+
+    void checkLastLine() {
+        // A last row without a newline is read by both readers
+        std::string data("CHROM\tPOS\tPLAF\nPf3D7_01_v3\t93157\t0.5\nPf3D7_01_v3\t94422\t0.25");
+        TxtReader serial;
+        serial.readFromSource(InputSource::memory(data.data(), data.size()));
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, serial.content_.size() );
+        CPPUNIT_ASSERT_EQUAL ( 0.25, serial.info_[1] );
+        TxtReader parallel;
+        parallel.setNumThreads(2);
+        parallel.readFromSource(InputSource::memory(data.data(), data.size()));
+        this->compareTxt(serial, parallel);
+        std::string vcfData = this->readFile("data/testData/PG0390-C.test.vcf");
+        CPPUNIT_ASSERT_EQUAL ( '\n', vcfData.back() );
+        vcfData.pop_back();
+        VcfReader vcf(InputSource::memory(vcfData.data(), vcfData.size()), "PG0390-C");
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, vcf.nSites() );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestInputSource );
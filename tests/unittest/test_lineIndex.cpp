@@ -0,0 +1,241 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "src/lineIndex.hpp"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestLineIndex : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestLineIndex );
+    CPPUNIT_TEST( checkBuild );
+    CPPUNIT_TEST( checkSidecar );
+    CPPUNIT_TEST( checkChunks );
+    CPPUNIT_TEST( checkTxtReader );
+    CPPUNIT_TEST( checkVcfReader );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    const char * vcfFile_;
+    const char * txtFile_;
+    size_t nTxtRows_;
+
+    std::string readFile(const char * fileName) {
+        std::ifstream in(fileName, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const char * fileName, const std::string & data) {
+        std::ofstream out(fileName, std::ios::binary);
+        out << data;
+    }
+
+    void compareIndex(const VariantIndex & expected,
+                      const VariantIndex & index) {
+        CPPUNIT_ASSERT ( expected.chrom_ == index.chrom_ );
+        CPPUNIT_ASSERT ( expected.position_.values() == index.position_.values() );
+        CPPUNIT_ASSERT ( expected.position_.offsets() == index.position_.offsets() );
+    }
+
+  public:
+    void setUp() {
+        // Copies, the sidecars are written next to them
+        this->vcfFile_ = "data/testData/lineIndex.test.vcf";
+        this->txtFile_ = "data/testData/lineIndex.test.txt";
+        this->nTxtRows_ = 20000;
+        this->writeFile(this->vcfFile_, this->readFile("data/testData/PG0390-C.test.vcf"));
+        std::ofstream txt(this->txtFile_);
+        txt << "CHROM\tPOS\tPLAF\n";
+        for (size_t i = 0; i < this->nTxtRows_; i++) {
+            txt << ((i < 15000) ? "Pf3D7_01_v3\t" : "Pf3D7_02_v3\t")
+                << (i + 1) * 10 << "\t0." << i % 1000 << "\n";
+        }
+    }
+
+    void tearDown() {
+        std::remove(this->vcfFile_);
+        std::remove(this->txtFile_);
+        std::remove(LineIndex::sidecarName(this->vcfFile_).c_str());
+        std::remove(LineIndex::sidecarName(this->txtFile_).c_str());
+    }
+
+    void checkBuild() {
+        LineIndex index;
+        index.build(this->vcfFile_);
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)594, index.nLines() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)14, index.chromRuns().size() );
+        CPPUNIT_ASSERT_EQUAL ( std::string("Pf3D7_01_v3"), index.chromNames()[0] );
+        CPPUNIT_ASSERT_EQUAL ( std::string("Pf3D7_14_v3"), index.chromNames()[13] );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)204, index.chromRuns()[0].nLines );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)204, index.chromRuns()[1].firstLine );
+        CPPUNIT_ASSERT_EQUAL ( index.dataStart(), index.chromRuns()[0].begin );
+        CPPUNIT_ASSERT_EQUAL ( index.chromRuns()[0].end, index.chromRuns()[1].begin );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->readFile(this->vcfFile_).size(), index.dataEnd() );
+
+        std::string bytes;
+        LineIndex::readRange(this->vcfFile_, index.chromRuns()[1].begin,
+                             index.chromRuns()[1].end, &bytes);
+        CPPUNIT_ASSERT_EQUAL ( std::string("Pf3D7_02_v3\t"), bytes.substr(0, 12) );
+        CPPUNIT_ASSERT_EQUAL ( '\n', bytes.back() );
+        CPPUNIT_ASSERT_THROW ( index.build("data/testData/noSuchFile.txt"), InvalidInputFile );
+    }
+
+    void checkSidecar() {
+        LineIndex built;
+        CPPUNIT_ASSERT ( built.loadOrBuild(this->vcfFile_) );
+        std::ifstream sidecar(LineIndex::sidecarName(this->vcfFile_).c_str());
+        CPPUNIT_ASSERT ( sidecar.good() );
+
+        LineIndex loaded;
+        CPPUNIT_ASSERT ( loaded.read(this->vcfFile_) );
+        CPPUNIT_ASSERT_EQUAL ( built.nLines(), loaded.nLines() );
+        CPPUNIT_ASSERT_EQUAL ( built.dataStart(), loaded.dataStart() );
+        CPPUNIT_ASSERT ( built.chromNames() == loaded.chromNames() );
+        for (size_t i = 0; i < built.chromRuns().size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( built.chromRuns()[i].begin, loaded.chromRuns()[i].begin );
+            CPPUNIT_ASSERT_EQUAL ( built.chromRuns()[i].end, loaded.chromRuns()[i].end );
+        }
+        // Read with another number of header lines, it is rebuilt
+        CPPUNIT_ASSERT ( !loaded.read(this->vcfFile_, 1) );
+
+        // The file grows, the sidecar is out of date
+        std::ofstream out(this->vcfFile_, std::ios::app);
+        out << "Pf3D7_14_v3\t3291000\t.\tA\tT\t100\tPASS\t.\tGT:AD\t0/1:10,5\n";
+        out.close();
+        CPPUNIT_ASSERT ( !loaded.read(this->vcfFile_) );
+        CPPUNIT_ASSERT ( loaded.loadOrBuild(this->vcfFile_) );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)595, loaded.nLines() );
+        CPPUNIT_ASSERT ( loaded.read(this->vcfFile_) );
+
+        // A corrupted sidecar is not used
+        std::string bytes = this->readFile(LineIndex::sidecarName(this->vcfFile_).c_str());
+        bytes[bytes.size() / 2] ^= 1;
+        this->writeFile(LineIndex::sidecarName(this->vcfFile_).c_str(), bytes);
+        CPPUNIT_ASSERT ( !loaded.read(this->vcfFile_) );
+
+        // Gzipped files are not indexed
+        CPPUNIT_ASSERT ( !loaded.loadOrBuild("data/testData/PG0390-C.test.vcf.gz") );
+    }
+
+    void checkChunks() {
+        LineIndex index;
+        index.build(this->txtFile_, 1);
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)this->nTxtRows_, index.nLines() );
+        std::string data = this->readFile(this->txtFile_);
+        std::vector <LineRange> chunks = index.chunks(index.all(), 4);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, chunks.size() );
+        uint64_t nLines = 0;
+        uint64_t begin = index.dataStart();
+        for (auto const &chunk : chunks) {
+            CPPUNIT_ASSERT_EQUAL ( nLines, chunk.firstLine );
+            CPPUNIT_ASSERT_EQUAL ( begin, chunk.begin );
+            CPPUNIT_ASSERT_EQUAL ( '\n', data[chunk.begin - 1] );
+            CPPUNIT_ASSERT ( chunk.nLines > 4000 );
+            CPPUNIT_ASSERT ( chunk.nLines < 6000 );
+            CPPUNIT_ASSERT_EQUAL ( (size_t)chunk.nLines,
+                (size_t)std::count(data.begin() + chunk.begin, data.begin() + chunk.end, '\n') );
+            nLines += chunk.nLines;
+            begin = chunk.end;
+        }
+        CPPUNIT_ASSERT_EQUAL ( index.nLines(), nLines );
+        CPPUNIT_ASSERT_EQUAL ( index.dataEnd(), begin );
+
+        // Cuts are at sampled lines, so there are fewer chunks than asked
+        // for when the range is short
+        chunks = index.chunks(index.chromRuns()[1], 8);
+        CPPUNIT_ASSERT ( chunks.size() > 1 );
+        CPPUNIT_ASSERT ( chunks.size() < 8 );
+        for (size_t i = 1; i < chunks.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( (uint64_t)0, chunks[i].firstLine % LineIndex::stride_ );
+        }
+        LineRange empty = {0, 0, 0, 0};
+        CPPUNIT_ASSERT ( index.chunks(empty, 4).empty() );
+    }
+
+    void checkTxtReader() {
+        TxtReader expected;
+        expected.readFromFile(this->txtFile_);
+        size_t nThreads[] = {1, 4};
+        // The first read writes the sidecar, the others use it
+        for ( auto n : nThreads ) {
+            TxtReader indexed;
+            indexed.setNumThreads(n);
+            indexed.setUseLineIndex(true);
+            indexed.readFromFile(this->txtFile_);
+            this->compareIndex(expected, indexed);
+            CPPUNIT_ASSERT ( expected.info_ == indexed.info_ );
+            CPPUNIT_ASSERT ( expected.header_ == indexed.header_ );
+        }
+
+        // Chromosomes that are not on the allow-list are not read
+        std::vector <std::string> chrom(1, "Pf3D7_02_v3");
+        std::vector < std::vector <int> > position(1, std::vector <int>(1, 150010));
+        TxtReader allowed;
+        allowed.setAllowedPositions(chrom, position);
+        allowed.readFromFile(this->txtFile_);
+        TxtReader allowedIndexed;
+        allowedIndexed.setAllowedPositions(chrom, position);
+        allowedIndexed.setUseLineIndex(true);
+        allowedIndexed.setNumThreads(4);
+        allowedIndexed.readFromFile(this->txtFile_);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, allowedIndexed.content_.size() );
+        this->compareIndex(allowed, allowedIndexed);
+        CPPUNIT_ASSERT ( allowed.content_ == allowedIndexed.content_ );
+    }
+
+    void checkVcfReader() {
+        VcfReader expected(this->vcfFile_, "PG0390-C");
+        VcfReader indexed;
+        indexed.setUseLineIndex(true);
+        indexed.open(this->vcfFile_, "PG0390-C");
+        this->compareIndex(expected, indexed);
+        CPPUNIT_ASSERT ( expected.refCountColumn().toVector() == indexed.refCountColumn().toVector() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, indexed.refColumn_.capacity() );
+
+        // Only two chromosomes, with and without the sidecar
+        std::vector <std::string> chrom;
+        chrom.push_back("Pf3D7_14_v3");
+        chrom.push_back("Pf3D7_02_v3");
+        VcfReader filtered;
+        filtered.setChromosomes(chrom);
+        filtered.open(this->vcfFile_, "PG0390-C");
+        CPPUNIT_ASSERT_EQUAL ( (size_t)61, filtered.nSites() );
+        indexed.setChromosomes(chrom);
+        indexed.open(this->vcfFile_, "PG0390-C");
+        this->compareIndex(filtered, indexed);
+        CPPUNIT_ASSERT ( filtered.altCountColumn().toVector() == indexed.altCountColumn().toVector() );
+        CPPUNIT_ASSERT_EQUAL ( std::string("Pf3D7_02_v3"), indexed.chrom_[0] );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestLineIndex );
@@ -0,0 +1,150 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "src/gzstream/gzstream.h"
+#include "src/rowEstimate.hpp"
+
+class TestRowEstimate : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestRowEstimate );
+    CPPUNIT_TEST( checkSmallFiles );
+    CPPUNIT_TEST( checkMissingFile );
+    CPPUNIT_TEST( checkLargeFile );
+    CPPUNIT_TEST( checkConcatenatedGzip );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    const char * largeFile_;
+    const char * largeFileGz_;
+    size_t nLargeRows_;
+
+  public:
+    void setUp() {
+        this->largeFile_ = "data/testData/rowEstimate.test.txt";
+        this->largeFileGz_ = "data/testData/rowEstimate.test.txt.gz";
+        this->nLargeRows_ = 20000;
+    }
+
+    void tearDown() {
+        std::remove(this->largeFile_);
+        std::remove(this->largeFileGz_);
+    }
+
+    void checkSmallFiles() {
+        // The test VCF is larger than the sample, its BGZF copy has the
+        // same size of data and so the same estimate
+        RowEstimate vcf = RowEstimate::ofFile("data/testData/PG0390-C.test.vcf");
+        RowEstimate vcfGz = RowEstimate::ofFile("data/testData/PG0390-C.test.vcf.gz");
+        CPPUNIT_ASSERT ( !vcf.exact );
+        CPPUNIT_ASSERT ( vcf.nRows > 594 * 95 / 100 );
+        CPPUNIT_ASSERT ( vcf.nRows < 594 * 105 / 100 );
+        CPPUNIT_ASSERT ( vcf.reserveSize() >= 594 );
+        CPPUNIT_ASSERT_EQUAL ( vcf.nRows, vcfGz.nRows );
+        CPPUNIT_ASSERT_EQUAL ( RowEstimate::dataSize("data/testData/PG0390-C.test.vcf"),
+                               RowEstimate::dataSize("data/testData/PG0390-C.test.vcf.gz") );
+
+        // Read to the end while sampling, so the counts are exact
+
+        RowEstimate txt = RowEstimate::ofFile("data/testData/txtReaderForTesting.txt", 1);
+        RowEstimate txtGz = RowEstimate::ofFile("data/testData/txtReaderForTesting.txt.gz", 1);
+        CPPUNIT_ASSERT ( txt.exact );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)100, txt.nRows );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)100, txt.reserveSize() );
+        CPPUNIT_ASSERT_EQUAL ( txt.nRows, txtGz.nRows );
+    }
+
+    void checkMissingFile() {
+        RowEstimate missing = RowEstimate::ofFile("data/testData/missing.txt");
+        CPPUNIT_ASSERT ( !missing.exact );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, missing.nRows );
+        CPPUNIT_ASSERT_EQUAL ( (uint64_t)0, RowEstimate::dataSize("data/testData/missing.txt") );
+    }
+
+    void checkLargeFile() {
+        std::ofstream out(this->largeFile_);
+        ogzstream outGz(this->largeFileGz_);
+        out << "CHROM\tPOS\tPLAF\n";
+        outGz << "CHROM\tPOS\tPLAF\n";
+        for ( size_t i = 0; i < this->nLargeRows_; i++ ) {
+            out << "Pf3D7_01_v3\t" << 100 + i * 7 << "\t0." << i % 1000 << "\n";
+            outGz << "Pf3D7_01_v3\t" << 100 + i * 7 << "\t0." << i % 1000 << "\n";
+        }
+        out.close();
+        outGz.close();
+
+        std::ifstream in(this->largeFile_, std::ios::binary | std::ios::ate);
+        uint64_t plainBytes = in.tellg();
+        // The gzip trailer has the size of the data
+        CPPUNIT_ASSERT_EQUAL ( plainBytes, RowEstimate::dataSize(this->largeFile_) );
+        CPPUNIT_ASSERT_EQUAL ( plainBytes, RowEstimate::dataSize(this->largeFileGz_) );
+
+        const char * files[] = {this->largeFile_, this->largeFileGz_};
+        for ( size_t i = 0; i < 2; i++ ) {
+            RowEstimate estimate = RowEstimate::ofFile(files[i], 1);
+            CPPUNIT_ASSERT ( !estimate.exact );
+            CPPUNIT_ASSERT ( estimate.nRows > this->nLargeRows_ * 95 / 100 );
+            CPPUNIT_ASSERT ( estimate.nRows < this->nLargeRows_ * 105 / 100 );
+            CPPUNIT_ASSERT ( estimate.reserveSize() > estimate.nRows );
+        }
+    }
+
+    void checkConcatenatedGzip() {
+        // A large member and a small one, as cat a.gz b.gz makes them
+        ogzstream first(this->largeFileGz_);
+        first << "CHROM\tPOS\tPLAF\n";
+        for ( size_t i = 0; i < this->nLargeRows_; i++ ) {
+            first << "Pf3D7_01_v3\t" << 100 + i * 7 << "\t0." << i % 1000 << "\n";
+        }
+        first.close();
+        ogzstream last(this->largeFile_);
+        last << "Pf3D7_02_v3\t100\t0.5\n";
+        last.close();
+        std::ifstream in(this->largeFile_, std::ios::binary);
+        std::string lastMember((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+        std::ofstream out(this->largeFileGz_, std::ios::app | std::ios::binary);
+        out << lastMember;
+        out.close();
+
+        // The trailer only has the size of the last member, it is not taken
+        // as a size that wrapped around 4 GiB
+        std::ifstream gz(this->largeFileGz_, std::ios::binary | std::ios::ate);
+        uint64_t fileBytes = gz.tellg();
+        CPPUNIT_ASSERT_EQUAL ( fileBytes, RowEstimate::dataSize(this->largeFileGz_) );
+        RowEstimate estimate = RowEstimate::ofFile(this->largeFileGz_, 1);
+        CPPUNIT_ASSERT ( !estimate.exact );
+        CPPUNIT_ASSERT ( estimate.nRows > 0 );
+        CPPUNIT_ASSERT ( estimate.nRows <= this->nLargeRows_ );
+        CPPUNIT_ASSERT ( estimate.reserveSize() <= estimate.maxRows );
+        CPPUNIT_ASSERT ( estimate.maxRows < fileBytes * 32 / 10 );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestRowEstimate );
@@ -0,0 +1,190 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+#include "src/inputSource.hpp"
+#include "src/siteAligner.hpp"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestSiteAligner : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestSiteAligner );
+    CPPUNIT_TEST( checkExclude );
+    CPPUNIT_TEST( checkStrictMismatch );
+    CPPUNIT_TEST( checkIntersect );
+    CPPUNIT_TEST( checkAllInputs );
+    CPPUNIT_TEST( checkChromOrder );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    TxtReader * txtReader_;
+    TxtReader * afterExclude_;
+    ExcludeMarker* excludedMarkers_;
+
+  public:
+    void setUp() {
+        this->txtReader_ = new TxtReader();
+        this->afterExclude_ = new TxtReader();
+        this->excludedMarkers_ = new ExcludeMarker();
+        this->txtReader_->readFromFile("data/testData/txtReaderForTesting.txt" );
+        this->afterExclude_->readFromFile("data/testData/txtReaderForTestingAfterExclude.txt");
+        this->excludedMarkers_->readFromFile("data/testData/txtReaderForTestingToBeExclude.txt" );
+    }
+
+    void tearDown() {
+        delete txtReader_;
+        delete afterExclude_;
+        delete excludedMarkers_;
+    }
+
+    void checkSameSites(TxtReader * expected, TxtReader * aligned) {
+        CPPUNIT_ASSERT_EQUAL ( expected->nLoci_, aligned->nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( expected->chrom_.size(), aligned->chrom_.size() );
+        for ( size_t i = 0; i < expected->chrom_.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( expected->chrom_[i], aligned->chrom_[i] );
+            CPPUNIT_ASSERT_EQUAL ( expected->indexOfChromStarts_[i], aligned->indexOfChromStarts_[i] );
+            CPPUNIT_ASSERT_EQUAL ( expected->position_[i].size(), aligned->position_[i].size() );
+            for ( size_t j = 0; j < expected->position_[i].size(); j++) {
+                CPPUNIT_ASSERT_EQUAL ( expected->position_[i][j], aligned->position_[i][j] );
+            }
+        }
+    }
+
+    void checkSameInfo(TxtReader * expected, TxtReader * aligned) {
+        CPPUNIT_ASSERT_EQUAL ( expected->info_.size(), aligned->info_.size() );
+        for ( size_t i = 0; i < expected->info_.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( expected->info_[i], aligned->info_[i] );
+        }
+    }
+
+    void checkExclude() {
+        SiteAligner aligner;
+        aligner.addInput(this->txtReader_, "txtReaderForTesting.txt");
+        aligner.addInput(this->excludedMarkers_, "exclude", ALIGN_EXCLUDE);
+        aligner.align();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)93, aligner.nSites() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)93, aligner.keptRows(0).size() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, aligner.keptRows(1).size() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)6, aligner.chrom().size() );
+        // Pf3D7_02_v3 100608 is excluded, 101269 is the first kept site
+        CPPUNIT_ASSERT_EQUAL ( (int)101269, aligner.position()[1][0] );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)13, aligner.keptRows(0)[12] );
+
+        aligner.apply();
+        this->checkSameSites(this->afterExclude_, this->txtReader_);
+        this->checkSameInfo(this->afterExclude_, this->txtReader_);
+    }
+
+    void checkStrictMismatch() {
+        SiteAligner aligner;
+        aligner.addInput(this->afterExclude_, "afterExclude");
+        aligner.addInput(this->txtReader_, "txtReaderForTesting.txt");
+        CPPUNIT_ASSERT_THROW ( aligner.align(), LociNumberUnequal );
+
+        // The extra sites are all on the exclude list
+        aligner.addInput(this->excludedMarkers_, "exclude", ALIGN_EXCLUDE);
+        CPPUNIT_ASSERT_NO_THROW ( aligner.align() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)93, aligner.nSites() );
+    }
+
+    void checkIntersect() {
+        SiteAligner aligner;
+        aligner.addInput(this->txtReader_, "txtReaderForTesting.txt",
+                         ALIGN_INTERSECT);
+        aligner.addInput(this->afterExclude_, "afterExclude");
+        aligner.align();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)93, aligner.nSites() );
+        aligner.apply();
+        this->checkSameSites(this->afterExclude_, this->txtReader_);
+        this->checkSameInfo(this->afterExclude_, this->txtReader_);
+    }
+
+    void checkAllInputs() {
+        VcfReader vcf("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        TxtReader ref;
+        ref.readFromFile("data/testData/PG0390-C.test.ref");
+        TxtReader alt;
+        alt.readFromFile("data/testData/PG0390-C.test.alt");
+        TxtReader plaf;
+        plaf.readFromFile("data/testData/labStrains.test.PLAF.txt");
+        TxtReader panel;
+        panel.readFromFile("data/testData/labStrains.test.panel.txt");
+        ExcludeMarker exclude;
+        exclude.readFromFile("data/testData/labStrains.test.exclude.txt");
+
+        SiteAligner aligner;
+        aligner.addInput(&vcf, "vcf");
+        aligner.addInput(&ref, "ref");
+        aligner.addInput(&alt, "alt");
+        aligner.addInput(&plaf, "plaf");
+        aligner.addInput(&panel, "panel");
+        aligner.addInput(&exclude, "exclude", ALIGN_EXCLUDE);
+        aligner.align();
+        size_t nKept = 594 - exclude.nLoci_;
+        CPPUNIT_ASSERT_EQUAL ( nKept, aligner.nSites() );
+        aligner.apply();
+        CPPUNIT_ASSERT_EQUAL ( nKept, vcf.nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( nKept, ref.nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( nKept, plaf.info_.size() );
+        CPPUNIT_ASSERT_EQUAL ( nKept, panel.content_.size() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, panel.content_[0].size() );
+        this->checkSameSites(&ref, &alt);
+        this->checkSameSites(&ref, &panel);
+    }
+
+    void checkChromOrder() {
+        // The second input lists the chromosomes the other way round, its
+        // rows are reordered to the chromosome order of the first
+        const std::string first = "CHROM\tPOS\tx\n"
+                                  "A\t1\t1.1\nA\t2\t1.2\n"
+                                  "B\t1\t1.3\nB\t2\t1.4\n";
+        const std::string second = "CHROM\tPOS\tx\n"
+                                   "B\t1\t1.3\nB\t2\t1.4\n"
+                                   "A\t1\t1.1\nA\t2\t1.2\n";
+        size_t sharedThreads = ThreadPool::shared().nThreads();
+        for ( size_t nThreads = 1; nThreads < 5; nThreads += 3 ) {
+            ThreadPool::shared().setNumThreads(nThreads);
+            TxtReader a;
+            a.readFromSource(InputSource::memory(first.data(), first.size()));
+            TxtReader b;
+            b.readFromSource(InputSource::memory(second.data(),
+                                                 second.size()));
+            SiteAligner aligner;
+            aligner.addInput(&a, "a");
+            aligner.addInput(&b, "b");
+            aligner.align();
+            aligner.apply();
+            this->checkSameSites(&a, &b);
+            this->checkSameInfo(&a, &b);
+            CPPUNIT_ASSERT_EQUAL ( 1.1, b.info_[0] );
+            CPPUNIT_ASSERT_EQUAL ( 1.4, b.info_[3] );
+        }
+        ThreadPool::shared().setNumThreads(sharedThreads);
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestSiteAligner );
@@ -0,0 +1,204 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "src/threadPool.hpp"
+#include "src/txtReader.hpp"
+#include "src/vcfReader.hpp"
+
+class TestThreadPool : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestThreadPool );
+    CPPUNIT_TEST( checkEveryTaskOnce );
+    CPPUNIT_TEST( checkLowestErrorThrown );
+    CPPUNIT_TEST( checkNested );
+    CPPUNIT_TEST( checkResize );
+    CPPUNIT_TEST( checkSameAsSerial );
+    CPPUNIT_TEST( checkUnevenTasks );
+    CPPUNIT_TEST( checkRanges );
+    CPPUNIT_TEST( checkReduce );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    size_t sharedThreads_;
+
+    void excludeWithThreads(size_t nThreads, TxtReader * panel) {
+        ThreadPool::shared().setNumThreads(nThreads);
+        ExcludeMarker excluded;
+        excluded.readFromFile("data/testData/txtReaderForTestingToBeExclude.txt");
+        panel->readFromFile("data/testData/txtReaderForTesting.txt");
+        panel->findAndKeepMarkers(&excluded);
+    }
+
+  public:
+    void setUp() {
+        this->sharedThreads_ = ThreadPool::shared().nThreads();
+    }
+
+    void tearDown() {
+        ThreadPool::shared().setNumThreads(this->sharedThreads_);
+    }
+
+    void checkEveryTaskOnce(){
+        ThreadPool pool(4);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, pool.nThreads() );
+        vector < std::atomic<int> > hits(1000);
+        for ( auto &hit : hits ){
+            hit = 0;
+        }
+        pool.parallelFor(hits.size(), [&](size_t i){ hits[i]++; });
+        for ( auto const &hit : hits ){
+            CPPUNIT_ASSERT_EQUAL ( 1, hit.load() );
+        }
+        pool.parallelFor(0, [&](size_t i){ hits[i]++; });
+    }
+
+    void checkLowestErrorThrown(){
+        ThreadPool pool(4);
+        std::atomic<size_t> nRun(0);
+        try {
+            pool.parallelFor(100, [&](size_t i){
+                nRun++;
+                if ( i == 70 ) throw std::runtime_error("70");
+                if ( i == 30 ) throw PositionUnsorted("30");
+            });
+            CPPUNIT_ASSERT( false );
+        } catch ( const PositionUnsorted & e ) {
+            CPPUNIT_ASSERT( e.src.find("30") != string::npos );
+        }
+        // Tasks after a failing one still run
+        CPPUNIT_ASSERT_EQUAL ( (size_t)100, nRun.load() );
+    }
+
+    void checkNested(){
+        ThreadPool pool(3);
+        std::atomic<size_t> total(0);
+        pool.parallelFor(8, [&](size_t){
+            pool.parallelFor(8, [&](size_t j){ total += j; });
+        });
+        CPPUNIT_ASSERT_EQUAL ( (size_t)(8 * 28), total.load() );
+    }
+
+    void checkResize(){
+        ThreadPool pool(1);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, pool.nThreads() );
+        std::thread::id caller = std::this_thread::get_id();
+        pool.parallelFor(10, [&](size_t){
+            CPPUNIT_ASSERT( std::this_thread::get_id() == caller );
+        });
+        pool.setNumThreads(3);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)3, pool.nThreads() );
+        std::atomic<size_t> total(0);
+        pool.parallelFor(10, [&](size_t i){ total += i; });
+        CPPUNIT_ASSERT_EQUAL ( (size_t)45, total.load() );
+    }
+
+    void checkSameAsSerial(){
+        TxtReader serial, parallel;
+        this->excludeWithThreads(1, &serial);
+        this->excludeWithThreads(4, &parallel);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)93, parallel.nLoci_ );
+        CPPUNIT_ASSERT( serial.chrom_ == parallel.chrom_ );
+        CPPUNIT_ASSERT( serial.position_.values() == parallel.position_.values() );
+        CPPUNIT_ASSERT( serial.position_.offsets() == parallel.position_.offsets() );
+        CPPUNIT_ASSERT( serial.indexOfChromStarts_ == parallel.indexOfChromStarts_ );
+        CPPUNIT_ASSERT( serial.content_ == parallel.content_ );
+        CPPUNIT_ASSERT( serial.info_ == parallel.info_ );
+
+        VcfReader vcfSerial("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        vcfSerial.finalize();
+        ThreadPool::shared().setNumThreads(1);
+        vcfSerial.findLegitSnpsGivenVQSLOD(2.0);
+        VcfReader vcfParallel("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        vcfParallel.finalize();
+        ThreadPool::shared().setNumThreads(4);
+        vcfParallel.findLegitSnpsGivenVQSLOD(2.0);
+        CPPUNIT_ASSERT( vcfSerial.legitVqslodAt == vcfParallel.legitVqslodAt );
+    }
+
+    void checkUnevenTasks(){
+        // The first share is slow, the other threads steal from it
+        ThreadPool pool(4);
+        vector < std::atomic<int> > hits(64);
+        for ( auto &hit : hits ){
+            hit = 0;
+        }
+        pool.parallelFor(hits.size(), [&](size_t i){
+            if ( i < 16 ){
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            hits[i]++;
+        });
+        for ( auto const &hit : hits ){
+            CPPUNIT_ASSERT_EQUAL ( 1, hit.load() );
+        }
+    }
+
+    void checkRanges(){
+        ThreadPool pool(3);
+        vector <int> covered(1003, 0);
+        pool.parallelFor(1, 1003, 100, [&](size_t begin, size_t end){
+            CPPUNIT_ASSERT( end - begin <= 100 );
+            for ( size_t i = begin; i < end; i++ ){
+                covered[i]++;
+            }
+        });
+        CPPUNIT_ASSERT_EQUAL ( 0, covered[0] );
+        for ( size_t i = 1; i < covered.size(); i++ ){
+            CPPUNIT_ASSERT_EQUAL ( 1, covered[i] );
+        }
+        pool.parallelFor(5, 5, 10, [&](size_t, size_t){ covered[0]++; });
+        CPPUNIT_ASSERT_EQUAL ( 0, covered[0] );
+    }
+
+    void checkReduce(){
+        vector <double> values;
+        for ( size_t i = 0; i < 10000; i++ ){
+            values.push_back(1.0 / (i + 1));
+        }
+        auto sum = [&](size_t begin, size_t end){
+            double total = 0;
+            for ( size_t i = begin; i < end; i++ ) total += values[i];
+            return total;
+        };
+        auto add = [](double a, double b){ return a + b; };
+        ThreadPool serial(1);
+        ThreadPool parallel(4);
+        double expected = serial.parallelReduce(0, values.size(), 64, 0.0, sum, add);
+        // Chunks are combined in order, so the result is bit for bit the same
+        for ( size_t run = 0; run < 5; run++ ){
+            CPPUNIT_ASSERT_EQUAL ( expected,
+                parallel.parallelReduce(0, values.size(), 64, 0.0, sum, add) );
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL ( sum(0, values.size()), expected, 1e-9 );
+        CPPUNIT_ASSERT_EQUAL ( 7.0, parallel.parallelReduce(3, 3, 1, 7.0, sum, add) );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestThreadPool );
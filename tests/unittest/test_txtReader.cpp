@@ -25,6 +25,9 @@
 
 #include <cppunit/TestCase.h>
 #include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include "src/binaryPanel.hpp"
 #include "src/txtReader.hpp"
 
 class TestTxtReader : public CppUnit::TestCase {
@@ -38,6 +41,17 @@ class TestTxtReader : public CppUnit::TestCase {
     CPPUNIT_TEST( checkSortedPositions );
     CPPUNIT_TEST( checkBadConversion );
     CPPUNIT_TEST( checkBadScientificNotation );
+    CPPUNIT_TEST( checkParallelRead );
+    CPPUNIT_TEST( checkParallelBadInput );
+    CPPUNIT_TEST( checkChunkRows );
+    CPPUNIT_TEST( checkBinaryPanel );
+    CPPUNIT_TEST( checkBinaryPanelCorrupted );
+    CPPUNIT_TEST( checkBinaryPanelByteOrder );
+    CPPUNIT_TEST( checkBinaryPanelStrains );
+    CPPUNIT_TEST( checkAllowedPositions );
+    CPPUNIT_TEST( checkSiteIndex );
+    CPPUNIT_TEST( checkQueries );
+    CPPUNIT_TEST( checkReread );
     CPPUNIT_TEST_SUITE_END();
 
   private:
@@ -81,6 +95,289 @@ class TestTxtReader : public CppUnit::TestCase {
         CPPUNIT_ASSERT_THROW ( tmp.readFromFile("data/testData/bad.plaf_badpos.txt"), PositionUnsorted );
     }
 
+    void compareReaders(TxtReader & serial, TxtReader & parallel) {
+        CPPUNIT_ASSERT_EQUAL ( serial.nLoci_, parallel.nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( serial.nInfoLines_, parallel.nInfoLines_ );
+        CPPUNIT_ASSERT_EQUAL ( serial.header_.size(), parallel.header_.size() );
+        CPPUNIT_ASSERT_EQUAL ( serial.info_.size(), parallel.info_.size() );
+        CPPUNIT_ASSERT_EQUAL ( serial.chrom_.size(), parallel.chrom_.size() );
+        CPPUNIT_ASSERT_EQUAL ( serial.position_.size(), parallel.position_.size() );
+        for ( size_t i = 0; i < serial.chrom_.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( serial.chrom_[i], parallel.chrom_[i] );
+            CPPUNIT_ASSERT_EQUAL ( serial.indexOfChromStarts_[i], parallel.indexOfChromStarts_[i] );
+            CPPUNIT_ASSERT_EQUAL ( serial.position_[i].size(), parallel.position_[i].size() );
+            for ( size_t j = 0; j < serial.position_[i].size(); j++) {
+                CPPUNIT_ASSERT_EQUAL ( serial.position_[i][j], parallel.position_[i][j] );
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL ( serial.content_.size(), parallel.content_.size() );
+        for ( size_t i = 0; i < serial.content_.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL ( serial.content_[i].size(), parallel.content_[i].size() );
+            for ( size_t j = 0; j < serial.content_[i].size(); j++) {
+                CPPUNIT_ASSERT_EQUAL ( serial.content_[i][j], parallel.content_[i][j] );
+            }
+        }
+    }
+
+    void checkParallelRead(){
+        const char * files[] = {"data/testData/txtReaderForTesting.txt",
+                                "data/testData/txtReaderForTesting.txt.gz",
+                                "data/testData/labStrains.test.panel.txt",
+                                "data/testData/labStrains.test.exclude.txt"};
+        for ( size_t nThreads = 2; nThreads < 9; nThreads += 3 ) {
+            for ( auto file : files ) {
+                TxtReader serial;
+                serial.readFromFile(file);
+                TxtReader parallel;
+                parallel.setNumThreads(nThreads);
+                parallel.readFromFile(file);
+                this->compareReaders(serial, parallel);
+            }
+        }
+    }
+
+    void checkParallelBadInput(){
+        TxtReader tmp;
+        tmp.setNumThreads(4);
+        CPPUNIT_ASSERT_THROW ( tmp.readFromFile("data/testData/bad.plaf.txt"), BadConversion );
+        TxtReader tmp2;
+        tmp2.setNumThreads(4);
+        CPPUNIT_ASSERT_THROW ( tmp2.readFromFile("data/testData/bad.plaf_scientific.txt"), BadScientificNotation );
+        TxtReader tmp3;
+        tmp3.setNumThreads(4);
+        CPPUNIT_ASSERT_THROW ( tmp3.readFromFile("data/testData/bad.plaf_badpos.txt"), PositionUnsorted );
+    }
+
+    void checkChunkRows(){
+        TxtReader tmp;
+        const string body = "Pf3D7_01_v3\t93157\t0.5\t1\n"
+                            "Pf3D7_01_v3\t94422\t0.25\t0\n"
+                            "Pf3D7_02_v3\t100\t1\t0.125";
+        TxtChunk chunk;
+        tmp.parseChunk(body.data(), body.data() + body.size(), &chunk);
+        CPPUNIT_ASSERT(!chunk.error_);
+        CPPUNIT_ASSERT_EQUAL((size_t)2, chunk.chromId_.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)3, chunk.rows_.size());
+        // Rows are allocated at their exact size and moved when merged
+        for (auto const &row : chunk.rows_) {
+            CPPUNIT_ASSERT_EQUAL((size_t)2, row.size());
+            CPPUNIT_ASSERT_EQUAL((size_t)2, row.capacity());
+        }
+        CPPUNIT_ASSERT_EQUAL(0.125, chunk.rows_[2][1]);
+        const double * lastRow = chunk.rows_[2].data();
+        tmp.mergeChunk(&chunk);
+        CPPUNIT_ASSERT_EQUAL((size_t)3, tmp.content_.size());
+        CPPUNIT_ASSERT_EQUAL(0.25, tmp.content_[1][0]);
+        CPPUNIT_ASSERT(lastRow == tmp.content_[2].data());
+    }
+
+    void checkBinaryPanel(){
+        const char * binFile = "binaryPanelForTesting.bin";
+        BinaryPanelType types[] = {BINARY_PANEL_AUTO, BINARY_PANEL_FLOAT64,
+                                   BINARY_PANEL_FLOAT32};
+        const char * files[] = {"data/testData/labStrains.test.panel.txt",
+                                "data/testData/txtReaderForTesting.txt.gz"};
+        for ( auto type : types ) {
+            for ( auto file : files ) {
+                TxtReader text;
+                text.readFromFile(file);
+                BinaryPanel::write(text, binFile, type);
+                TxtReader binary;
+                binary.readFromFile(binFile);
+                this->compareReaders(text, binary);
+                CPPUNIT_ASSERT_EQUAL ( text.header_.size(), binary.header_.size() );
+                for ( size_t i = 0; i < text.header_.size(); i++) {
+                    CPPUNIT_ASSERT_EQUAL ( text.header_[i], binary.header_[i] );
+                }
+            }
+        }
+        std::remove(binFile);
+    }
+
+    void checkBinaryPanelByteOrder(){
+        const char * binFile = "binaryPanelForTesting.bin";
+        TxtReader text;
+        text.readFromFile("data/testData/labStrains.test.panel.txt");
+        BinaryPanel::write(text, binFile, BINARY_PANEL_FLOAT64);
+        std::ifstream in(binFile, std::ios::binary);
+        string bytes((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+        in.close();
+        std::remove(binFile);
+
+        // The integers are little-endian whatever the host is
+        const unsigned char * data =
+            reinterpret_cast<const unsigned char *>(bytes.data());
+        CPPUNIT_ASSERT_EQUAL ( 1u, (unsigned)data[8] );
+        CPPUNIT_ASSERT_EQUAL ( 0u, (unsigned)data[11] );
+        size_t nLoci = 0;
+        for (size_t i = 0; i < 8; i++) {
+            nLoci |= (size_t)data[16 + i] << (8 * i);
+        }
+        CPPUNIT_ASSERT_EQUAL ( text.content_.size(), nLoci );
+        // The first position follows the chromosome offsets in the payload
+        size_t stringBytes = 0;
+        for (size_t i = 0; i < 8; i++) {
+            stringBytes |= (size_t)data[40 + i] << (8 * i);
+        }
+        const unsigned char * pos = data + 64 + stringBytes +
+                                    (text.chrom_.size() + 1) * 8;
+        CPPUNIT_ASSERT_EQUAL ( 93157, pos[0] | pos[1] << 8 | pos[2] << 16 |
+                                      pos[3] << 24 );
+    }
+
+    void checkBinaryPanelStrains(){
+        const char * binFile = "binaryPanelForTesting.bin";
+        // Without any sites the strain names are still kept
+        const string empty = "CHROM\tPOS\ta\tb\n";
+        TxtReader text;
+        text.readFromSource(InputSource::memory(empty.data(), empty.size()));
+        BinaryPanel::write(text, binFile);
+        TxtReader binary;
+        binary.readFromFile(binFile);
+        std::remove(binFile);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, binary.content_.size() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, binary.header_.size() );
+        CPPUNIT_ASSERT_EQUAL ( string("b"), binary.header_[1] );
+
+        // Rows that do not match the strains are not written
+        const string ragged = "CHROM\tPOS\ta\tb\n"
+                              "Pf3D7_01_v3\t100\t1\t0\n"
+                              "Pf3D7_01_v3\t200\t1\n";
+        TxtReader raggedText;
+        raggedText.readFromSource(InputSource::memory(ragged.data(),
+                                                      ragged.size()));
+        CPPUNIT_ASSERT_THROW ( BinaryPanel::write(raggedText, binFile), InvalidBinaryPanel );
+        std::ifstream written(binFile);
+        CPPUNIT_ASSERT ( !written.good() );
+    }
+
+    void checkBinaryPanelCorrupted(){
+        const char * binFile = "binaryPanelForTesting.bin";
+        const char * badFile = "binaryPanelForTesting.bad.bin";
+        TxtReader text;
+        text.readFromFile("data/testData/labStrains.test.panel.txt");
+        BinaryPanel::write(text, binFile);
+
+        std::ifstream in(binFile, std::ios::binary);
+        string bytes((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+        in.close();
+
+        std::ofstream truncated(badFile, std::ios::binary);
+        truncated.write(bytes.data(), bytes.size() - 10);
+        truncated.close();
+        TxtReader tmp;
+        CPPUNIT_ASSERT_THROW ( tmp.readFromFile(badFile), InvalidBinaryPanel );
+
+        bytes[bytes.size() - 3] ^= 0x01;
+        std::ofstream flipped(badFile, std::ios::binary);
+        flipped.write(bytes.data(), bytes.size());
+        flipped.close();
+        TxtReader tmp2;
+        CPPUNIT_ASSERT_THROW ( tmp2.readFromFile(badFile), InvalidBinaryPanel );
+
+        std::remove(binFile);
+        std::remove(badFile);
+    }
+
+    void checkAllowedPositions(){
+        // Loading only the sites of afterExclude_ is the same as excluding
+        TxtReader allowed;
+        allowed.setAllowedPositions(*this->afterExclude_);
+        allowed.readFromFile("data/testData/txtReaderForTesting.txt");
+        this->compareReaders(*this->afterExclude_, allowed);
+
+        TxtReader allowedParallel;
+        allowedParallel.setNumThreads(3);
+        allowedParallel.setAllowedPositions(*this->afterExclude_);
+        allowedParallel.readFromFile("data/testData/txtReaderForTesting.txt.gz");
+        this->compareReaders(*this->afterExclude_, allowedParallel);
+
+        const char * binFile = "binaryPanelForTesting.bin";
+        BinaryPanel::write(*this->txtReader_, binFile);
+        TxtReader allowedBinary;
+        allowedBinary.setAllowedPositions(*this->afterExclude_);
+        allowedBinary.readFromFile(binFile);
+        this->compareReaders(*this->afterExclude_, allowedBinary);
+        std::remove(binFile);
+
+        // Only the excluded sites, chromosomes 2, 4 and 6 remain
+        TxtReader excludedOnly;
+        excludedOnly.setAllowedPositions(*this->excludedMarkers_);
+        excludedOnly.readFromFile("data/testData/txtReaderForTesting.txt");
+        CPPUNIT_ASSERT_EQUAL ( (size_t)7, excludedOnly.nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)3, excludedOnly.chrom_.size() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, excludedOnly.position_[0].size() );
+        CPPUNIT_ASSERT_EQUAL ( (int)144877, excludedOnly.position_[1][0] );
+        CPPUNIT_ASSERT_EQUAL ( (double)47, excludedOnly.info_[4] );
+
+        TxtReader nothing;
+        nothing.setAllowedPositions(vector <string>(), vector < vector <int> >());
+        nothing.readFromFile("data/testData/txtReaderForTesting.txt");
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, nothing.nLoci_ );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, nothing.chrom_.size() );
+    }
+
+    void checkSiteIndex(){
+        CPPUNIT_ASSERT_EQUAL ( (size_t)100, this->txtReader_->nSites() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, this->txtReader_->chromIndexOfSite(0) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, this->txtReader_->chromIndexOfSite(11) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, this->txtReader_->chromIndexOfSite(12) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)5, this->txtReader_->chromIndexOfSite(99) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)12, this->txtReader_->siteIndex(1, 0) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)45, this->txtReader_->siteIndex(3, 0) );
+        for ( size_t i = 0; i < 6; i++) {
+            CPPUNIT_ASSERT_EQUAL ( this->txtReader_->indexOfChromStarts_[i],
+                                   this->txtReader_->siteIndex(i, 0) );
+        }
+    }
+
+    void checkQueries(){
+        TxtReader * reader = this->txtReader_;
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, reader->locate("Pf3D7_01_v3", 93157) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)11, reader->locate("Pf3D7_01_v3", 100330) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)12, reader->locate("Pf3D7_02_v3", 100608) );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, reader->locate("Pf3D7_01_v3", 93158) );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, reader->locate("Pf3D7_02_v3", 93157) );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, reader->locate("notAChrom", 93157) );
+        for ( size_t i = 0; i < reader->nSites(); i++ ){
+            size_t chromI = reader->chromIndexOfSite(i);
+            int pos = reader->position_.values()[i];
+            CPPUNIT_ASSERT_EQUAL ( i, reader->locate(reader->chrom_[chromI], pos) );
+        }
+
+        // Both ends are included
+        SiteRange sites = reader->range("Pf3D7_01_v3", 94422, 95518);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, sites.begin );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)5, sites.end );
+        sites = reader->range("Pf3D7_01_v3", 94423, 95517);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, sites.begin );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)4, sites.end );
+        sites = reader->range("Pf3D7_02_v3", 0, 1000000000);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)12, sites.begin );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)28, sites.end );
+        CPPUNIT_ASSERT( reader->range("Pf3D7_01_v3", 1, 10).empty() );
+        CPPUNIT_ASSERT( reader->range("Pf3D7_01_v3", 95518, 94422).empty() );
+        CPPUNIT_ASSERT( reader->range("notAChrom", 0, 1000000000).empty() );
+
+        vector <int> query;
+        query.push_back(1);
+        query.push_back(93157);
+        query.push_back(94459);
+        query.push_back(94460);
+        query.push_back(100330);
+        query.push_back(200000);
+        vector <size_t> found = reader->locate("Pf3D7_01_v3", query);
+        CPPUNIT_ASSERT_EQUAL ( query.size(), found.size() );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, found[0] );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, found[1] );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)2, found[2] );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, found[3] );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)11, found[4] );
+        CPPUNIT_ASSERT_EQUAL ( VariantIndex::npos, found[5] );
+    }
+
     void checkSizeBefore(){
         CPPUNIT_ASSERT_EQUAL ( (size_t)100, this->txtReader_->info_.size() );
         CPPUNIT_ASSERT_EQUAL ( (size_t)100, this->txtReader_->nLoci_ );
@@ -301,8 +598,6 @@ class TestTxtReader : public CppUnit::TestCase {
 
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->info_.size(), this->afterExclude_->info_.size() );
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->content_.size(), this->afterExclude_->content_.size() );
-        CPPUNIT_ASSERT_EQUAL (this->txtReader_->keptContent_.size(), this->afterExclude_->keptContent_.size() );
-        CPPUNIT_ASSERT_EQUAL (this->txtReader_->keptContent_.size(), (size_t)0 );
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->nInfoLines_, this->afterExclude_->nInfoLines_ );
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->nInfoLines_, (size_t)1);
 
@@ -323,8 +618,6 @@ class TestTxtReader : public CppUnit::TestCase {
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->indexOfChromStarts_.size(), (size_t)6 );
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->position_.size(), this->afterExclude_->position_.size() );
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->position_.size(), (size_t)6 );
-        CPPUNIT_ASSERT_EQUAL (this->txtReader_->keptPosition_.size(), this->afterExclude_->keptPosition_.size() );
-        CPPUNIT_ASSERT_EQUAL (this->txtReader_->keptPosition_.size(), (size_t)0 );
 
         for ( size_t i = 0; i < 6; i++) {
             CPPUNIT_ASSERT_EQUAL (this->txtReader_->chrom_[i], this->afterExclude_->chrom_[i] );
@@ -337,6 +630,21 @@ class TestTxtReader : public CppUnit::TestCase {
         }
         CPPUNIT_ASSERT_EQUAL (this->txtReader_->nLoci_, this->afterExclude_->nLoci_ );
     }
+
+    void checkReread() {
+        // The same reader through a bad, a compressed and a plain file
+        TxtReader reader;
+        CPPUNIT_ASSERT_THROW ( reader.readFromFile("data/testData/bad.plaf_scientific.txt"), BadScientificNotation );
+        reader.readFromFile("data/testData/txtReaderForTesting.txt.gz");
+        reader.readFromFile("data/testData/txtReaderForTestingAfterExclude.txt");
+        CPPUNIT_ASSERT_EQUAL ( this->afterExclude_->nLoci_, reader.nLoci_ );
+        CPPUNIT_ASSERT ( this->afterExclude_->header_ == reader.header_ );
+        CPPUNIT_ASSERT ( this->afterExclude_->info_ == reader.info_ );
+        CPPUNIT_ASSERT ( this->afterExclude_->content_ == reader.content_ );
+        CPPUNIT_ASSERT ( this->afterExclude_->chromId_ == reader.chromId_ );
+        CPPUNIT_ASSERT ( this->afterExclude_->position_.values() == reader.position_.values() );
+        CPPUNIT_ASSERT ( this->afterExclude_->indexOfChromStarts_ == reader.indexOfChromStarts_ );
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( TestTxtReader );
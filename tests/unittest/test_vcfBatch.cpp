@@ -0,0 +1,152 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstdio>
+#include <fstream>
+#include "src/exceptions.hpp"
+#include "src/threadPool.hpp"
+#include "src/vcfBatch.hpp"
+
+class TestVcfBatch : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestVcfBatch );
+    CPPUNIT_TEST( checkColumns );
+    CPPUNIT_TEST( checkStacked );
+    CPPUNIT_TEST( checkOpenFileBound );
+    CPPUNIT_TEST( checkContigMismatch );
+    CPPUNIT_TEST( checkSiteMismatch );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    size_t sharedThreads_;
+    const char * changedFile_;
+
+  public:
+    void setUp() {
+        this->sharedThreads_ = ThreadPool::shared().nThreads();
+        ThreadPool::shared().setNumThreads(4);
+        this->changedFile_ = "data/testData/batch.test.vcf";
+    }
+
+    void tearDown() {
+        ThreadPool::shared().setNumThreads(this->sharedThreads_);
+        std::remove(this->changedFile_);
+    }
+
+    void addSamples(VcfBatch * batch, size_t nSamples) {
+        for ( size_t i = 0; i < nSamples; i++ ) {
+            batch->add((i % 2 == 0) ? "data/testData/PG0390-C.test.vcf" :
+                                      "data/testData/PG0390-C.test.vcf.gz",
+                       "PG0390-C");
+        }
+    }
+
+    // Copy of the test VCF without its first line that starts with prefix
+    void writeChangedCopy(const string & prefix) {
+        std::ifstream in("data/testData/PG0390-C.test.vcf");
+        std::ofstream out(this->changedFile_);
+        string line;
+        bool dropped = false;
+        while (getline(in, line)) {
+            if (!dropped && line.compare(0, prefix.size(), prefix) == 0) {
+                dropped = true;
+                continue;
+            }
+            out << line << "\n";
+        }
+    }
+
+    void checkColumns() {
+        VcfReader vcf("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        vcf.finalize();
+        VcfBatch batch;
+        this->addSamples(&batch, 5);
+        batch.load();
+        CPPUNIT_ASSERT_EQUAL ( (size_t)5, batch.nSamples() );
+        CPPUNIT_ASSERT_EQUAL ( vcf.refCount.size(), batch.nSites() );
+        CPPUNIT_ASSERT ( vcf.chromId_ == batch.chromId() );
+        CPPUNIT_ASSERT ( vcf.position_.values() == batch.position().values() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)16, batch.contigLines().size() );
+        for ( size_t sampleI = 0; sampleI < batch.nSamples(); sampleI++ ) {
+            for ( size_t siteI = 0; siteI < batch.nSites(); siteI++ ) {
+                CPPUNIT_ASSERT_EQUAL ( vcf.refCount[siteI],
+                    (double)batch.refCount(sampleI)[siteI] );
+                CPPUNIT_ASSERT_EQUAL ( vcf.altCount[siteI],
+                    (double)batch.altCount(sampleI)[siteI] );
+            }
+        }
+    }
+
+    void checkStacked() {
+        VcfBatch batch;
+        this->addSamples(&batch, 3);
+        batch.load();
+        vector <int> ref = batch.stackedRefCount();
+        vector <int> alt = batch.stackedAltCount();
+        CPPUNIT_ASSERT_EQUAL ( batch.nSites() * 3, ref.size() );
+        for ( size_t siteI = 0; siteI < batch.nSites(); siteI++ ) {
+            for ( size_t sampleI = 0; sampleI < 3; sampleI++ ) {
+                CPPUNIT_ASSERT_EQUAL ( batch.refCount(sampleI)[siteI],
+                                       ref[siteI * 3 + sampleI] );
+                CPPUNIT_ASSERT_EQUAL ( batch.altCount(sampleI)[siteI],
+                                       alt[siteI * 3 + sampleI] );
+            }
+        }
+    }
+
+    void checkOpenFileBound() {
+        VcfBatch bounded;
+        bounded.setMaxOpenFiles(1);
+        this->addSamples(&bounded, 4);
+        bounded.load();
+        VcfBatch open;
+        this->addSamples(&open, 4);
+        open.load();
+        CPPUNIT_ASSERT ( bounded.stackedRefCount() == open.stackedRefCount() );
+        CPPUNIT_ASSERT ( bounded.stackedAltCount() == open.stackedAltCount() );
+        bounded.setMaxOpenFiles(0);
+        CPPUNIT_ASSERT_EQUAL ( (size_t)1, bounded.maxOpenFiles() );
+    }
+
+    void checkContigMismatch() {
+        this->writeChangedCopy("##contig=");
+        VcfBatch batch;
+        this->addSamples(&batch, 2);
+        batch.add(this->changedFile_, "PG0390-C");
+        CPPUNIT_ASSERT_THROW ( batch.load(), ContigMismatch );
+    }
+
+    void checkSiteMismatch() {
+        this->writeChangedCopy("Pf3D7_01_v3");
+        VcfBatch batch;
+        this->addSamples(&batch, 2);
+        batch.add(this->changedFile_, "PG0390-C");
+        batch.add("data/testData/PG0390-C.test.missing.vcf", "PG0390-C");
+        CPPUNIT_ASSERT_THROW ( batch.load(), LociNumberUnequal );
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestVcfBatch );
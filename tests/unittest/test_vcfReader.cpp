@@ -25,18 +25,32 @@
 
 #include <cppunit/TestCase.h>
 #include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "src/rowEstimate.hpp"
 #include "src/vcfReader.hpp"
 
 class TestVCF : public CppUnit::TestCase {
     CPPUNIT_TEST_SUITE(TestVCF);
     CPPUNIT_TEST(testMainConstructor);
     CPPUNIT_TEST(testInvalidSampleInVcf);
+    CPPUNIT_TEST(testChromList);
+    CPPUNIT_TEST(testUnsortedPositions);
+    CPPUNIT_TEST(testTruncatedLine);
+    CPPUNIT_TEST(testReopen);
+    CPPUNIT_TEST(testReserved);
+    CPPUNIT_TEST(testColumns);
+    CPPUNIT_TEST(testVqslodThreshold);
+    CPPUNIT_TEST(testRefresh);
+    CPPUNIT_TEST(testRefreshRewritten);
     CPPUNIT_TEST_SUITE_END();
 
  private:
     VcfReader* vcf_;
     VcfReader* vcfGz_;
     double eps;
+    double floatEps;
 
  public:
     void setUp() {
@@ -45,6 +59,7 @@ class TestVCF : public CppUnit::TestCase {
         this->vcfGz_ = new VcfReader("data/testData/PG0390-C.test.vcf.gz",
             "PG0390-C");
         this->eps = 0.00000000001;
+        this->floatEps = 0.000001;
     }
 
     void tearDown() {
@@ -64,6 +79,350 @@ class TestVCF : public CppUnit::TestCase {
         CPPUNIT_ASSERT_THROW(VcfReader("data/testData/PG0390-C.test.vcf.gz",
             "PG0370-C"), InvalidSampleInVcf);
     }
+
+    void testChromList() {
+        // Built while the lines are read
+        CPPUNIT_ASSERT_EQUAL((size_t)14, this->vcf_->chrom_.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)14, this->vcf_->chromId_.size());
+        CPPUNIT_ASSERT_EQUAL((size_t)594, this->vcf_->nSites());
+        CPPUNIT_ASSERT_EQUAL(string("Pf3D7_01_v3"), this->vcf_->chrom_[0]);
+        CPPUNIT_ASSERT_EQUAL(string("Pf3D7_14_v3"), this->vcf_->chrom_[13]);
+        CPPUNIT_ASSERT_EQUAL((size_t)0, this->vcf_->indexOfChromStarts_[0]);
+        CPPUNIT_ASSERT_EQUAL((size_t)204, this->vcf_->indexOfChromStarts_[1]);
+        CPPUNIT_ASSERT_EQUAL((size_t)216, this->vcf_->indexOfChromStarts_[2]);
+        CPPUNIT_ASSERT_EQUAL((size_t)545, this->vcf_->indexOfChromStarts_[13]);
+        vector <VariantLine> lines = this->parseTestFile(false);
+        for (size_t i = 0; i < lines.size(); i++) {
+            size_t chromI = this->vcf_->chromIndexOfSite(i);
+            CPPUNIT_ASSERT_EQUAL(this->vcf_->chromId_[chromI],
+                                 lines[i].chromId);
+            CPPUNIT_ASSERT_EQUAL(this->vcf_->position_.values()[i],
+                                 lines[i].pos);
+        }
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->chrom_.size(),
+                             this->vcfGz_->chrom_.size());
+        CPPUNIT_ASSERT(this->vcf_->position_.values() ==
+                       this->vcfGz_->position_.values());
+    }
+
+    void testUnsortedPositions() {
+        // Swap the first two variants of the test file
+        const char * unsortedFile = "data/testData/unsorted.test.vcf";
+        std::ifstream in("data/testData/PG0390-C.test.vcf");
+        std::ofstream out(unsortedFile);
+        string line;
+        vector <string> body;
+        while (getline(in, line)) {
+            if (line[0] == '#') {
+                out << line << "\n";
+            } else {
+                body.push_back(line);
+            }
+        }
+        std::swap(body[0], body[1]);
+        for (auto const &bodyLine : body) {
+            out << bodyLine << "\n";
+        }
+        out.close();
+        CPPUNIT_ASSERT_THROW(VcfReader(unsortedFile, "PG0390-C"),
+                             PositionUnsorted);
+        std::remove(unsortedFile);
+    }
+
+    void testTruncatedLine() {
+        vector <string> body;
+        string header;
+        this->readTestFile(&header, &body);
+        size_t sampleColumn = this->vcf_->sampleColumnIndex_;
+        VariantLine line;
+        line.parse(body[1], sampleColumn);
+        // Cut after CHROM, or with an empty POS, the line has no site and
+        // does not keep the position of the line before
+        string chrom = body[0].substr(0, body[0].find('\t'));
+        CPPUNIT_ASSERT_THROW(line.parse(chrom, sampleColumn),
+                             VcfInvalidVariantEntry);
+        CPPUNIT_ASSERT_THROW(line.parse(chrom + "\t", sampleColumn),
+                             VcfInvalidVariantEntry);
+        CPPUNIT_ASSERT_THROW(line.parse(chrom + "\t\tid", sampleColumn),
+                             VcfInvalidVariantEntry);
+
+        const char * truncatedFile = "data/testData/truncated.test.vcf";
+        std::ofstream out(truncatedFile);
+        out << header << body[0] << chrom << "\n";
+        out.close();
+        CPPUNIT_ASSERT_THROW(VcfReader(truncatedFile, "PG0390-C"),
+                             VcfInvalidVariantEntry);
+        std::remove(truncatedFile);
+    }
+
+    // The data lines of the test file, parsed one by one
+    vector <VariantLine> parseTestFile(bool extractPlaf) {
+        std::ifstream in("data/testData/PG0390-C.test.vcf");
+        vector <VariantLine> lines;
+        string line;
+        while (getline(in, line)) {
+            if (line[0] != '#') {
+                lines.push_back(VariantLine(line,
+                    this->vcf_->sampleColumnIndex_, extractPlaf));
+            }
+        }
+        return lines;
+    }
+
+    // The header and the body lines of the test file
+    void readTestFile(string * header, vector <string> * body) {
+        std::ifstream in("data/testData/PG0390-C.test.vcf");
+        string line;
+        while (getline(in, line)) {
+            if (line[0] == '#') {
+                *header += line + "\n";
+            } else {
+                body->push_back(line + "\n");
+            }
+        }
+    }
+
+    void appendTo(const char * fileName, const string & data) {
+        std::ofstream out(fileName, std::ios::app | std::ios::binary);
+        out << data;
+    }
+
+    void compareFirstSites(const VcfReader & vcf, size_t nSites) {
+        CPPUNIT_ASSERT_EQUAL(nSites, vcf.nLoci_);
+        CPPUNIT_ASSERT_EQUAL(nSites, vcf.refCountColumn().size());
+        for (size_t i = 0; i < nSites; i++) {
+            CPPUNIT_ASSERT_EQUAL(
+                this->vcf_->chromId_[this->vcf_->chromIndexOfSite(i)],
+                vcf.chromId_[vcf.chromIndexOfSite(i)]);
+            CPPUNIT_ASSERT_EQUAL(this->vcf_->position_.values()[i],
+                                 vcf.position_.values()[i]);
+            CPPUNIT_ASSERT_EQUAL(this->vcf_->refCountColumn()[i],
+                                 vcf.refCountColumn()[i]);
+            CPPUNIT_ASSERT_EQUAL(this->vcf_->altCountColumn()[i],
+                                 vcf.altCountColumn()[i]);
+        }
+        CPPUNIT_ASSERT_EQUAL(vcf.position_.nValues(), nSites);
+        CPPUNIT_ASSERT_EQUAL(vcf.chromId_.size(), vcf.position_.size());
+        CPPUNIT_ASSERT_EQUAL(vcf.chromId_.size(),
+                             vcf.indexOfChromStarts_.size());
+    }
+
+    void testRefresh() {
+        const char * growingFile = "data/testData/growing.test.vcf";
+        string header;
+        vector <string> body;
+        this->readTestFile(&header, &body);
+        std::remove(growingFile);
+        this->appendTo(growingFile, header);
+        for (size_t i = 0; i < 100; i++) {
+            this->appendTo(growingFile, body[i]);
+        }
+        VcfReader vcf(growingFile, "PG0390-C");
+        this->compareFirstSites(vcf, 100);
+        CPPUNIT_ASSERT(vcf.checkpoint().valid);
+        CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(header.size()),
+                             vcf.checkpoint().headerSize);
+        CPPUNIT_ASSERT_EQUAL(VCF_UNCHANGED, vcf.refresh());
+
+        // A line that is still being written is left for later
+        for (size_t i = 100; i < 300; i++) {
+            this->appendTo(growingFile, body[i]);
+        }
+        this->appendTo(growingFile, body[300].substr(0, 20));
+        CPPUNIT_ASSERT_EQUAL(VCF_APPENDED, vcf.refresh());
+        this->compareFirstSites(vcf, 300);
+        CPPUNIT_ASSERT_EQUAL(
+            this->vcf_->chrom_[this->vcf_->chromIndexOfSite(299)],
+            vcf.checkpoint().lastChrom);
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->position_.values()[299],
+                             vcf.checkpoint().lastPos);
+        CPPUNIT_ASSERT_EQUAL(VCF_UNCHANGED, vcf.refresh());
+
+        // The rest of the file, the last line waits for its newline
+        this->appendTo(growingFile, body[300].substr(20));
+        for (size_t i = 301; i + 1 < body.size(); i++) {
+            this->appendTo(growingFile, body[i]);
+        }
+        string lastLine = body.back().substr(0, body.back().size() - 1);
+        this->appendTo(growingFile, lastLine);
+        CPPUNIT_ASSERT_EQUAL(VCF_APPENDED, vcf.refresh());
+        this->compareFirstSites(vcf, body.size() - 1);
+        this->appendTo(growingFile, "\n");
+        CPPUNIT_ASSERT_EQUAL(VCF_APPENDED, vcf.refresh());
+        this->compareFirstSites(vcf, body.size());
+        CPPUNIT_ASSERT(this->vcf_->chromId_ == vcf.chromId_);
+        CPPUNIT_ASSERT(this->vcf_->indexOfChromStarts_ ==
+                       vcf.indexOfChromStarts_);
+
+        // open() leaves a last line that is cut short, e.g. in its AD, to
+        // the refresh() after its newline
+        string cutLine = body.back().substr(0, body.back().size() - 3);
+        this->appendTo(growingFile, cutLine);
+        VcfReader reopened(growingFile, "PG0390-C");
+        this->compareFirstSites(reopened, body.size());
+        uint64_t offset = reopened.checkpoint().offset;
+        CPPUNIT_ASSERT_EQUAL(VCF_UNCHANGED, reopened.refresh());
+        this->appendTo(growingFile, body.back().substr(cutLine.size()));
+        CPPUNIT_ASSERT_EQUAL(VCF_APPENDED, reopened.refresh());
+        CPPUNIT_ASSERT_EQUAL(body.size() + 1, reopened.nLoci_);
+        CPPUNIT_ASSERT_EQUAL(offset + body.back().size(),
+                             reopened.checkpoint().offset);
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->refCountColumn()[body.size() - 1],
+                             reopened.refCountColumn()[body.size()]);
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->altCountColumn()[body.size() - 1],
+                             reopened.altCountColumn()[body.size()]);
+
+        // The same with the line index, which counts the cut line
+        this->appendTo(growingFile, cutLine);
+        VcfReader indexed;
+        indexed.setUseLineIndex(true);
+        indexed.open(growingFile, "PG0390-C");
+        CPPUNIT_ASSERT_EQUAL(body.size() + 1, indexed.nLoci_);
+        this->appendTo(growingFile, body.back().substr(cutLine.size()));
+        CPPUNIT_ASSERT_EQUAL(VCF_APPENDED, indexed.refresh());
+        CPPUNIT_ASSERT_EQUAL(body.size() + 2, indexed.nLoci_);
+        std::remove(LineIndex::sidecarName(growingFile).c_str());
+        std::remove(growingFile);
+    }
+
+    void testRefreshRewritten() {
+        const char * growingFile = "data/testData/growing.test.vcf";
+        string header;
+        vector <string> body;
+        this->readTestFile(&header, &body);
+        std::remove(growingFile);
+        this->appendTo(growingFile, header);
+        for (size_t i = 0; i < 200; i++) {
+            this->appendTo(growingFile, body[i]);
+        }
+        VcfReader vcf(growingFile, "PG0390-C");
+
+        // Truncated
+        std::ofstream(growingFile, std::ios::trunc) << header << body[0];
+        CPPUNIT_ASSERT_EQUAL(VCF_RELOADED, vcf.refresh());
+        this->compareFirstSites(vcf, 1);
+
+        // Rewritten with other lines, and a longer file
+        std::ofstream rewritten(growingFile, std::ios::trunc);
+        rewritten << header;
+        for (size_t i = 1; i < 100; i++) {
+            rewritten << body[i];
+        }
+        rewritten.close();
+        CPPUNIT_ASSERT_EQUAL(VCF_RELOADED, vcf.refresh());
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(99), vcf.nLoci_);
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->position_.values()[1],
+                             vcf.position_.values()[0]);
+        CPPUNIT_ASSERT_EQUAL(VCF_UNCHANGED, vcf.refresh());
+        std::remove(growingFile);
+
+        // Gzipped files are read again, memory is read once
+        CPPUNIT_ASSERT_EQUAL(VCF_RELOADED, this->vcfGz_->refresh());
+        this->compareFirstSites(*this->vcfGz_, this->vcf_->nLoci_);
+        VcfReader inMemory(InputSource::memory(header.data(), header.size(),
+                                               "header"), "PG0390-C");
+        CPPUNIT_ASSERT_EQUAL(VCF_UNCHANGED, inMemory.refresh());
+    }
+
+    void testColumns() {
+        // The columns are there before finalize(), the double vectors not
+        VcfReader vcf("data/testData/PG0390-C.test.vcf", "PG0390-C", true);
+        CPPUNIT_ASSERT(vcf.refCount.empty());
+        CPPUNIT_ASSERT_EQUAL(vcf.nLoci_, vcf.refCountColumn().size());
+        CPPUNIT_ASSERT_EQUAL(vcf.nLoci_, vcf.plafColumn().size());
+        vector <VariantLine> lines = this->parseTestFile(true);
+        CPPUNIT_ASSERT_EQUAL(lines.size(), vcf.nLoci_);
+        for (size_t i = 0; i < vcf.nLoci_; i++) {
+            CPPUNIT_ASSERT_EQUAL(lines[i].ref, vcf.refCountColumn().raw()[i]);
+            CPPUNIT_ASSERT_EQUAL(static_cast<double>(lines[i].alt),
+                                 vcf.altCountColumn()[i]);
+            CPPUNIT_ASSERT_EQUAL(lines[i].vqslod, vcf.vqslodColumn()[i]);
+            CPPUNIT_ASSERT_DOUBLES_EQUAL(lines[i].plaf, vcf.plafColumn()[i],
+                                         this->floatEps);
+        }
+        // Half the bytes of the double vectors for the counts and PLAF
+        CPPUNIT_ASSERT_EQUAL(sizeof(double) / 2, sizeof(int32_t));
+        CPPUNIT_ASSERT_EQUAL(sizeof(double) / 2, sizeof(float));
+
+        vcf.finalize();
+        CPPUNIT_ASSERT(vcf.refCount == vcf.refCountColumn().toVector());
+        CPPUNIT_ASSERT(vcf.plaf == vcf.plafColumn().toVector());
+
+        // Removed markers are removed from the columns too
+        vector <size_t> kept;
+        for (size_t i = 0; i < vcf.nLoci_; i += 3) {
+            kept.push_back(i);
+        }
+        vcf.findWhoToBeKeptGivenIndex(kept);
+        vcf.removeMarkers();
+        CPPUNIT_ASSERT_EQUAL(kept.size(), vcf.refCountColumn().size());
+        CPPUNIT_ASSERT_EQUAL(kept.size(), vcf.vqslodColumn().size());
+        for (size_t i = 0; i < kept.size(); i++) {
+            CPPUNIT_ASSERT_EQUAL(vcf.refCount[kept[i]],
+                                 vcf.refCountColumn()[i]);
+            CPPUNIT_ASSERT_EQUAL(lines[kept[i]].alt,
+                                 vcf.altCountColumn().raw()[i]);
+        }
+    }
+
+    void testVqslodThreshold() {
+        // 0.617 as a float is 0.61699998, a threshold between the two keeps
+        // the second site only while VQSLOD is a double
+        this->vcf_->findLegitSnpsGivenVQSLOD(0.61699999);
+        CPPUNIT_ASSERT(std::find(this->vcf_->legitVqslodAt.begin(),
+                                 this->vcf_->legitVqslodAt.end(), 1) !=
+                       this->vcf_->legitVqslodAt.end());
+        this->vcf_->findLegitSnpsGivenVQSLOD(0.617);
+        CPPUNIT_ASSERT(std::find(this->vcf_->legitVqslodAt.begin(),
+                                 this->vcf_->legitVqslodAt.end(), 1) ==
+                       this->vcf_->legitVqslodAt.end());
+    }
+
+    void testReserved() {
+        // The estimate was large enough, the columns never had to grow
+        size_t estimate = RowEstimate::ofFile(
+            "data/testData/PG0390-C.test.vcf").reserveSize();
+        CPPUNIT_ASSERT(estimate >= this->vcf_->refColumn_.size());
+        CPPUNIT_ASSERT_EQUAL(estimate, this->vcf_->refColumn_.capacity());
+        CPPUNIT_ASSERT_EQUAL(estimate, this->vcfGz_->refColumn_.capacity());
+        this->vcf_->finalize();
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->refCount.size(),
+                             this->vcf_->refCount.capacity());
+        CPPUNIT_ASSERT_EQUAL(this->vcf_->plaf.size(),
+                             this->vcf_->plaf.capacity());
+
+        VcfReader hinted;
+        hinted.setSizeHint(1000);
+        hinted.open("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(1000),
+                             hinted.refColumn_.capacity());
+    }
+
+    void testReopen() {
+        this->vcfGz_->finalize();
+        VcfReader reader;
+        reader.open("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        size_t capacity = reader.refColumn_.capacity();
+        // A failed open leaves the reader usable
+        CPPUNIT_ASSERT_THROW(reader.open("data/testData/PG0390-C.test.vcf",
+                                         "PG0390-D"), InvalidSampleInVcf);
+        reader.open("data/testData/PG0390-C.test.vcf.gz", "PG0390-C");
+        reader.finalize();
+        CPPUNIT_ASSERT_EQUAL(capacity, reader.refColumn_.capacity());
+        CPPUNIT_ASSERT(this->vcfGz_->headerLines == reader.headerLines);
+        CPPUNIT_ASSERT(this->vcfGz_->refCount == reader.refCount);
+        CPPUNIT_ASSERT(this->vcfGz_->altCount == reader.altCount);
+        CPPUNIT_ASSERT(this->vcfGz_->chromId_ == reader.chromId_);
+        CPPUNIT_ASSERT(this->vcfGz_->position_.values() ==
+                       reader.position_.values());
+        CPPUNIT_ASSERT(this->vcfGz_->indexOfChromStarts_ ==
+                       reader.indexOfChromStarts_);
+
+        reader.reset();
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reader.nLoci_);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reader.refColumn_.size());
+        CPPUNIT_ASSERT_EQUAL(capacity, reader.refColumn_.capacity());
+    }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestVCF);
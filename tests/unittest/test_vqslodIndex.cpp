@@ -0,0 +1,103 @@
+/*
+ * dEploid is used for deconvoluting Plasmodium falciparum genome from
+ * mix-infected patient sample.
+ *
+ * Copyright (C) 2016-2017 University of Oxford
+ *
+ * Author: Sha (Joe) Zhu
+ *
+ * This file is part of dEploid.
+ *
+ * dEploid is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "src/vcfReader.hpp"
+#include "src/vqslodIndex.hpp"
+
+class TestVqslodIndex : public CppUnit::TestCase {
+    CPPUNIT_TEST_SUITE( TestVqslodIndex );
+    CPPUNIT_TEST( checkAgainstScan );
+    CPPUNIT_TEST( checkMask );
+    CPPUNIT_TEST( checkManyThresholds );
+    CPPUNIT_TEST_SUITE_END();
+
+  private:
+    VcfReader * vcf_;
+    VqslodIndex * index_;
+    vector <double> thresholds_;
+
+    vector <size_t> scan(double threshold) {
+        this->vcf_->findLegitSnpsGivenVQSLOD(threshold);
+        return this->vcf_->legitVqslodAt;
+    }
+
+  public:
+    void setUp() {
+        this->vcf_ = new VcfReader("data/testData/PG0390-C.test.vcf", "PG0390-C");
+        this->vcf_->finalize();
+        this->index_ = new VqslodIndex(*this->vcf_);
+        // Below, at and above the observed values
+        this->thresholds_.push_back(-1000.0);
+        this->thresholds_.push_back(-5.0);
+        this->thresholds_.push_back(0.0);
+        this->thresholds_.push_back(0.617);
+        this->thresholds_.push_back(2.5);
+        this->thresholds_.push_back(8.08);
+        this->thresholds_.push_back(1000.0);
+    }
+
+    void tearDown() {
+        delete this->index_;
+        delete this->vcf_;
+    }
+
+    void checkAgainstScan(){
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, this->index_->nSites() );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)594, this->index_->count(-1000.0) );
+        CPPUNIT_ASSERT_EQUAL ( (size_t)0, this->index_->count(1000.0) );
+        for ( auto const &threshold : this->thresholds_ ){
+            vector <size_t> expected = this->scan(threshold);
+            CPPUNIT_ASSERT_EQUAL ( expected.size(), this->index_->count(threshold) );
+            CPPUNIT_ASSERT ( expected == this->index_->keptSites(threshold) );
+        }
+    }
+
+    void checkMask(){
+        for ( auto const &threshold : this->thresholds_ ){
+            vector <bool> mask = this->index_->keptMask(threshold);
+            CPPUNIT_ASSERT_EQUAL ( (size_t)594, mask.size() );
+            for ( size_t i = 0; i < mask.size(); i++ ){
+                CPPUNIT_ASSERT_EQUAL ( this->vcf_->vqslod[i] > threshold,
+                                       (bool)mask[i] );
+            }
+        }
+    }
+
+    void checkManyThresholds(){
+        vector <size_t> counts = this->index_->count(this->thresholds_);
+        vector < vector <size_t> > sites = this->index_->keptSites(this->thresholds_);
+        CPPUNIT_ASSERT_EQUAL ( this->thresholds_.size(), counts.size() );
+        CPPUNIT_ASSERT_EQUAL ( this->thresholds_.size(), sites.size() );
+        for ( size_t i = 0; i < this->thresholds_.size(); i++ ){
+            CPPUNIT_ASSERT_EQUAL ( this->index_->count(this->thresholds_[i]), counts[i] );
+            CPPUNIT_ASSERT_EQUAL ( counts[i], sites[i].size() );
+            CPPUNIT_ASSERT ( this->scan(this->thresholds_[i]) == sites[i] );
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TestVqslodIndex );